@@ -0,0 +1,337 @@
+/*!************************************************************************
+\file   BasicObjectAllocator.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Compile-time configured counterpart of ObjectAllocator. The object size,
+  header type, padding, alignment, debug patterns, checks and statistics are
+  template parameters, so every "if" on them folds away: with ReleasePolicy
+  Allocate is a pointer pop and Free a pointer push. The page layout
+  (OALayout), the page lookup, block index and in-use bits (PageInfo), the
+  block patterns, pad checks and headers (ObjectAllocator's static helpers)
+  are ObjectAllocator's own code; only the free list and page list are kept
+  here. The extras built on ObjectAllocator (slabs, arenas, handles,
+  telemetry, page growth) aren't available.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef BASICOBJECTALLOCATORH
+#define BASICOBJECTALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <cstring>
+#include <new>
+
+/*!
+  No headers, no padding, no patterns, no checks, no statistics
+*/
+struct ReleasePolicy
+{
+  static const OAConfig::HBLOCK_TYPE HeaderType = OAConfig::hbNone; //!< header kept in front of each block
+  static const unsigned HeaderAdditional = 0;                      //!< user-defined bytes of an extended header
+  static const unsigned PadBytes = 0;                              //!< pad bytes on each side of a block
+  static const unsigned Alignment = 0;                             //!< block alignment (0 = none)
+  static const bool Patterns = false;                              //!< write the UNALLOCATED/ALLOCATED/FREED patterns
+  static const bool Checks = false;                                //!< validate every Free (boundary, double free, pads)
+  static const bool Statistics = false;                            //!< keep the OAStats counters
+};
+
+/*!
+  Everything ObjectAllocator does with DebugOn_ set, fixed at compile time
+*/
+template <unsigned Pad = 8, OAConfig::HBLOCK_TYPE Header = OAConfig::hbBasic, unsigned Align = 0, unsigned Additional = 0>
+struct DebugPolicy
+{
+  static const OAConfig::HBLOCK_TYPE HeaderType = Header; //!< header kept in front of each block
+  static const unsigned HeaderAdditional = Additional;   //!< user-defined bytes of an extended header
+  static const unsigned PadBytes = Pad;                   //!< pad bytes on each side of a block
+  static const unsigned Alignment = Align;                //!< block alignment (0 = none)
+  static const bool Patterns = true;                      //!< write the UNALLOCATED/ALLOCATED/FREED patterns
+  static const bool Checks = true;                        //!< validate every Free (boundary, double free, pads)
+  static const bool Statistics = true;                    //!< keep the OAStats counters
+};
+
+/*!
+  Object allocator whose layout and debugging are decided by Policy at compile time.
+  The page layout is the same as ObjectAllocator's for the equivalent OAConfig.
+*/
+template <size_t ObjectSize, typename Policy = ReleasePolicy>
+class BasicObjectAllocator
+{
+  static_assert(ObjectSize >= sizeof(GenericObject), "objects must be able to hold the free list link");
+  static_assert(Policy::HeaderType != OAConfig::hbExternal, "external headers need run-time allocation, use ObjectAllocator");
+
+public:
+  static const size_t HEADER_SIZE = Policy::HeaderType == OAConfig::hbBasic ? OAConfig::BASIC_HEADER_SIZE
+                                  : Policy::HeaderType == OAConfig::hbExtended ? sizeof(unsigned) + sizeof(unsigned short) + sizeof(char) + Policy::HeaderAdditional
+                                  : 0;                                                                      //!< bytes of header per block
+  static const size_t LEFT_ALIGN_SIZE = OALayout(ObjectSize, 1, HEADER_SIZE, Policy::PadBytes, Policy::Alignment).LeftAlignSize_;       //!< alignment bytes before the first block
+  static const size_t BLOCK_SIZE = HEADER_SIZE + 2 * Policy::PadBytes + ObjectSize;                                                  //!< header, pads and object
+  static const size_t INTER_ALIGN_SIZE = OALayout(ObjectSize, 1, HEADER_SIZE, Policy::PadBytes, Policy::Alignment).InterAlignSize_;     //!< alignment bytes between blocks
+  static const size_t BLOCK_STRIDE = OALayout(ObjectSize, 1, HEADER_SIZE, Policy::PadBytes, Policy::Alignment).BlockStride_;           //!< distance between two blocks
+  static const size_t FIRST_BLOCK_OFFSET = OALayout(ObjectSize, 1, HEADER_SIZE, Policy::PadBytes, Policy::Alignment).FirstBlockOffset_; //!< first object from the page start
+
+  /*!
+    Creates the allocator and its first page
+
+    \param ObjectsPerPage
+      Number of objects for each page of memory.
+
+    \param MaxPages
+      Maximum number of pages before throwing an exception. A value
+      of 0 means unlimited.
+  */
+  explicit BasicObjectAllocator(unsigned ObjectsPerPage = DEFAULT_OBJECTS_PER_PAGE, unsigned MaxPages = DEFAULT_MAX_PAGES)
+    : ObjectsPerPage_(ObjectsPerPage ? ObjectsPerPage : 1), MaxPages_(MaxPages),
+      PageSize_(OALayout(ObjectSize, ObjectsPerPage_, HEADER_SIZE, Policy::PadBytes, Policy::Alignment).PageSize_)
+  {
+    Stats_.ObjectSize_ = ObjectSize;
+    Stats_.PageSize_ = PageSize_;
+    AllocateNewPage();
+  }
+
+  /*!
+    Releases every page (never throws)
+  */
+  ~BasicObjectAllocator()
+  {
+    while (PageList_)
+    {
+      GenericObject* next = PageList_->Next;
+      delete[] reinterpret_cast<char*>(PageList_);
+      PageList_ = next;
+    }
+    for (PageInfo* page : Pages_)
+      delete page;
+  }
+
+  /*!
+    Takes an object from the free list and gives it to the client
+
+    \return
+      The object.
+
+    \throw OAException
+      E_NO_PAGES when MaxPages is reached, E_NO_MEMORY when new fails.
+  */
+  void* Allocate()
+  {
+    if (!FreeList_)
+    {
+      if (MaxPages_ > 0 && PagesInUse_ >= MaxPages_)
+        throw OAException(OAException::E_NO_PAGES, "Allocate:  You have reached maximum pages limit.");
+      AllocateNewPage();
+    }
+
+    GenericObject* block = FreeList_;
+    FreeList_ = block->Next;
+
+    if (Policy::Patterns)
+      std::memset(block, ObjectAllocator::ALLOCATED_PATTERN, ObjectSize);
+
+    if (Policy::Checks)
+    {
+      PageInfo* page = PageInfo::Find(Pages_, block);
+      size_t index = 0;
+      page->IndexOf(block, BLOCK_STRIDE, index);
+      page->SetInUse(index, true);
+    }
+
+    // the header records the allocation number, so it is counted whenever there is one
+    if (Policy::Statistics || HEADER_SIZE)
+      ++Stats_.Allocations_;
+    if (Policy::Statistics)
+    {
+      ++Stats_.ObjectsInUse_;
+      --Stats_.FreeObjects_;
+      if (Stats_.ObjectsInUse_ > Stats_.MostObjects_)
+        Stats_.MostObjects_ = Stats_.ObjectsInUse_;
+    }
+
+    if (HEADER_SIZE)
+      ObjectAllocator::WriteHeader(block, Header(), Policy::PadBytes, Stats_.Allocations_, true);
+
+    return block;
+  }
+
+  /*!
+    Returns an object to the free list
+
+    \param Object
+      The object (nullptr is ignored).
+
+    \throw OAException
+      With Checks on: E_BAD_BOUNDARY, E_MULTIPLE_FREE or E_CORRUPTED_BLOCK.
+  */
+  void Free(void* Object)
+  {
+    if (!Object)
+      return;
+
+    if (Policy::Checks)
+    {
+      PageInfo* page = PageInfo::Find(Pages_, Object);
+      size_t index = 0;
+      if (!page || !page->IndexOf(Object, BLOCK_STRIDE, index))
+        throw OAException(OAException::E_BAD_BOUNDARY, "Boundary: Object has bad boundary.");
+      if (!page->IsInUse(index))
+        throw OAException(OAException::E_MULTIPLE_FREE, "Free: Object has already been freed.");
+      if (Policy::PadBytes && ObjectAllocator::PadsCorrupted(Object, ObjectSize, Policy::PadBytes))
+        throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted: Object has corruption.");
+      page->SetInUse(index, false);
+    }
+
+    if (Policy::Patterns)
+      std::memset(Object, ObjectAllocator::FREED_PATTERN, ObjectSize);
+
+    GenericObject* block = static_cast<GenericObject*>(Object);
+    block->Next = FreeList_;
+    FreeList_ = block;
+
+    if (Policy::Statistics)
+    {
+      ++Stats_.Deallocations_;
+      ++Stats_.FreeObjects_;
+      --Stats_.ObjectsInUse_;
+    }
+
+    if (HEADER_SIZE)
+      ObjectAllocator::WriteHeader(block, Header(), Policy::PadBytes, 0, false);
+  }
+
+  /*!
+    Calls the callback fn for each block that is potentially corrupted
+    (always 0 without pad bytes)
+
+    \param fn
+      Called with each corrupted block and the object size.
+
+    \return
+      The number of corrupted blocks.
+  */
+  unsigned ValidatePages(ObjectAllocator::VALIDATECALLBACK fn) const
+  {
+    unsigned corrupted = 0;
+    if (Policy::PadBytes == 0)
+      return corrupted;
+
+    for (GenericObject* page = PageList_; page; page = page->Next)
+    {
+      char* block = reinterpret_cast<char*>(page) + FIRST_BLOCK_OFFSET;
+      for (unsigned i = 0; i < ObjectsPerPage_; ++i, block += BLOCK_STRIDE)
+      {
+        if (ObjectAllocator::PadsCorrupted(block, ObjectSize, Policy::PadBytes))
+        {
+          ++corrupted;
+          fn(block, ObjectSize);
+        }
+      }
+    }
+    return corrupted;
+  }
+
+  /*!
+    Describes the policy as the equivalent run-time configuration
+  */
+  OAConfig GetConfig() const
+  {
+    OAConfig config(false, ObjectsPerPage_, MaxPages_, Policy::Patterns || Policy::Checks, Policy::PadBytes,
+                    Header(), Policy::Alignment);
+    config.LeftAlignSize_ = static_cast<unsigned>(LEFT_ALIGN_SIZE);
+    config.InterAlignSize_ = static_cast<unsigned>(INTER_ALIGN_SIZE);
+    return config;
+  }
+
+  /*!
+    Returns the statistics (sizes and pages only without Policy::Statistics)
+  */
+  OAStats GetStats() const
+  {
+    OAStats stats = Stats_;
+    stats.PagesInUse_ = PagesInUse_;
+    return stats;
+  }
+
+  const void *GetFreeList() const { return FreeList_; } //!< returns a pointer to the internal free list
+  const void *GetPageList() const { return PageList_; } //!< returns a pointer to the internal page list
+
+    // Prevent copy construction and assignment
+  BasicObjectAllocator(const BasicObjectAllocator &oa) = delete;            //!< Do not implement!
+  BasicObjectAllocator &operator=(const BasicObjectAllocator &oa) = delete; //!< Do not implement!
+
+private:
+  /*!
+    Allocates a page and pushes its blocks onto the free list, in the same
+    order and with the same patterns as ObjectAllocator::AllocateNewPage
+  */
+  void AllocateNewPage()
+  {
+    char* page = nullptr;
+    PageInfo* info = nullptr;
+    try
+    {
+      page = new char[PageSize_]{};
+      if (Policy::Checks)
+        info = new PageInfo(page, FIRST_BLOCK_OFFSET, ObjectsPerPage_, PageSize_);
+    }
+    catch (const std::bad_alloc&)
+    {
+      delete[] page;
+      throw OAException(OAException::E_NO_MEMORY, "allocate_new_page: No system memory available");
+    }
+
+    if (Policy::Patterns && LEFT_ALIGN_SIZE)
+      std::memset(page + sizeof(void*), ObjectAllocator::ALIGN_PATTERN, LEFT_ALIGN_SIZE);
+
+    char* block = page + FIRST_BLOCK_OFFSET;
+    for (unsigned i = 0; i < ObjectsPerPage_; ++i, block += BLOCK_STRIDE)
+    {
+      if (Policy::Patterns)
+        ObjectAllocator::FormatBlock(block, ObjectSize, Policy::PadBytes, i + 1 < ObjectsPerPage_ ? INTER_ALIGN_SIZE : 0);
+      else if (Policy::PadBytes)
+      {
+        // pads are what the checks look at, so they are written even without patterns
+        std::memset(block - Policy::PadBytes, ObjectAllocator::PAD_PATTERN, Policy::PadBytes);
+        std::memset(block + ObjectSize, ObjectAllocator::PAD_PATTERN, Policy::PadBytes);
+      }
+
+      GenericObject* object = reinterpret_cast<GenericObject*>(block);
+      object->Next = FreeList_;
+      FreeList_ = object;
+    }
+
+    GenericObject* link = reinterpret_cast<GenericObject*>(page);
+    link->Next = PageList_;
+    PageList_ = link;
+    ++PagesInUse_;
+
+    if (Policy::Checks)
+      PageInfo::Insert(Pages_, info);
+    if (Policy::Statistics)
+      Stats_.FreeObjects_ += ObjectsPerPage_;
+  }
+
+  /*!
+    The header settings of the policy, as ObjectAllocator takes them
+  */
+  static OAConfig::HeaderBlockInfo Header()
+  {
+    return OAConfig::HeaderBlockInfo(Policy::HeaderType, Policy::HeaderAdditional);
+  }
+
+  unsigned ObjectsPerPage_;         //!< number of objects on each page
+  unsigned MaxPages_;               //!< maximum number of pages (0=unlimited)
+  size_t PageSize_;                 //!< size of a page including all headers, padding, etc.
+  unsigned PagesInUse_ = 0;         //!< number of pages allocated
+  OAStats Stats_{};                 //!< counters, maintained only with Policy::Statistics
+  GenericObject* PageList_ = nullptr; //!< the beginning of the list of pages
+  GenericObject* FreeList_ = nullptr; //!< the beginning of the list of objects
+  std::vector<PageInfo*> Pages_;    //!< pages sorted by address, only with Policy::Checks
+};
+
+#endif
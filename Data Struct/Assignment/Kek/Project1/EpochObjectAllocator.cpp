@@ -0,0 +1,447 @@
+///*!************************************************************************
+//\file   EpochObjectAllocator.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "EpochObjectAllocator.h"
+#include <thread>
+
+namespace
+{
+    //!< Retire batches on each page of the batch pool (a page stays within 16 KB)
+    const unsigned BATCHES_PER_PAGE = 31;
+
+    //!< Times Allocate lets the readers run when the limit is reached and they hold retired blocks
+    const unsigned ALLOCATE_WAITS = 64;
+
+    //!< Slot the calling thread last pinned in, where its next Pin starts looking
+    thread_local unsigned ReaderHint = 0;
+
+    /*!
+      Configuration of the pool of retire batches: no checks, pages from the OS,
+      just enough of them for RETIRE_BATCHES
+    */
+    OAConfig BatchConfig()
+    {
+        const unsigned pages = (EpochObjectAllocator::RETIRE_BATCHES + BATCHES_PER_PAGE - 1) / BATCHES_PER_PAGE;
+        OAConfig config(false, BATCHES_PER_PAGE, pages);
+        config.OSPages_ = true;
+        return config;
+    }
+}
+
+/**
+ * @brief Constructs an EpochObjectAllocator.
+ * The blocks' ObjectAllocator creates its first page, and the batch pool every page
+ * of retire batches it will ever have, so no retire takes memory. Every reader slot
+ * starts free and the epoch at 1.
+ * @param ObjectSize The size of each object to be managed by the allocator.
+ * @param config Configuration settings for the blocks' ObjectAllocator.
+ * @throw OAException Throws an exception if a page can't be created.
+ */
+EpochObjectAllocator::EpochObjectAllocator(size_t ObjectSize, const OAConfig& config)
+    : Epoch_{ 1 }, Pages_{ ObjectSize, config }, Batches_{ sizeof(RetireBatch), BatchConfig() },
+      Open_{ nullptr }, Oldest_{ nullptr }, Newest_{ nullptr }, Pending_{ 0 }
+{
+    Batches_.Reserve(RETIRE_BATCHES);
+    for (ReaderSlot& reader : Readers_)
+    {
+        reader.State.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Destructor for the EpochObjectAllocator.
+ * The batches and the blocks they hold are released with the pages of the two
+ * ObjectAllocators.
+ */
+EpochObjectAllocator::~EpochObjectAllocator()
+{
+}
+
+/**
+ * @brief Allocates a block of memory for an object.
+ * When the page limit is reached and blocks are retired, they are reclaimed (as
+ * far as the pinned readers allow) and the allocation is tried again. While the
+ * readers still hold every retired block, the thread yields to let them move on,
+ * ALLOCATE_WAITS times at most.
+ * @param label Optional label for the block, passed on to the ObjectAllocator.
+ * @return void* Pointer to the allocated block of memory.
+ * @throw OAException Throws an exception if memory cannot be allocated due to
+ *        reaching the limit of pages or no system memory available.
+ */
+void* EpochObjectAllocator::Allocate(const char* label)
+{
+    std::lock_guard<std::mutex> guard(Lock_);
+    try
+    {
+        return Pages_.Allocate(label);
+    }
+    catch (const OAException& exception)
+    {
+        if (exception.code() != OAException::E_NO_PAGES || (!Open_ && !Oldest_))
+        {
+            throw;
+        }
+    }
+
+    for (unsigned wait = 0; Collect() == 0 && (Open_ || Oldest_) && wait < ALLOCATE_WAITS; ++wait)
+    {
+        std::this_thread::yield();
+    }
+    return Pages_.Allocate(label);
+}
+
+/**
+ * @brief Frees a block at once.
+ * Only for blocks that were never reachable by a reader (say, a node built and
+ * then dropped before it was linked in); anything a reader may have seen must be
+ * retired instead.
+ * @param Object Pointer to the object to be freed.
+ * @throw OAException Throws an exception if the ObjectAllocator rejects the block.
+ */
+void EpochObjectAllocator::Free(void* Object)
+{
+    std::lock_guard<std::mutex> guard(Lock_);
+    Pages_.Free(Object);
+}
+
+/**
+ * @brief Retires a block that has been unlinked from the structure, waiting for the
+ * readers when every batch is held by them.
+ * TryRetire is tried until it takes the block, yielding in between with Lock_
+ * released, so the writer is held back (rather than failing) while the readers
+ * catch up. The calling thread must not be pinned, or it would wait on itself.
+ * @param Object The block, already unreachable for readers that pin from now on
+ *        (nullptr is ignored).
+ * @throw OAException Throws an exception if a reclaimed block is rejected by the
+ *        ObjectAllocator.
+ */
+void EpochObjectAllocator::Retire(void* Object)
+{
+    while (!TryRetire(Object))
+    {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief Retires a block unless every batch is held by the readers.
+ * The block goes into the open batch; it is not touched, as readers may still be
+ * reading it. A batch comes from the batch pool's free list (see TakeBatch). When
+ * the batch is full it is closed, the epoch is moved on if every pinned reader has
+ * seen it, and the batches closed two epochs ago or more are freed. Once more than
+ * half of the batches are waiting, every call tries to move the epoch on and free
+ * them, not only the call that fills a batch, so reclaiming keeps up with a writer
+ * that retires faster than the readers let the epoch move.
+ * @param Object The block, already unreachable for readers that pin from now on
+ *        (nullptr is ignored).
+ * @return bool True if the block was retired; false if no batch could be had (the
+ *         block is not retired then, and the caller still owns it).
+ * @throw OAException Throws an exception if a reclaimed block is rejected by the
+ *        ObjectAllocator.
+ */
+bool EpochObjectAllocator::TryRetire(void* Object)
+{
+    if (!Object)
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> guard(Lock_);
+    if (!Open_)
+    {
+        Open_ = TakeBatch();
+        if (!Open_)
+        {
+            return false;
+        }
+        Open_->Next = nullptr;
+        Open_->Count = 0;
+    }
+    Open_->Blocks[Open_->Count++] = Object;
+    Pending_.store(Pending_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (Open_->Count == RETIRE_BATCH)
+    {
+        Close();
+        TryAdvance();
+        FreeSafeBatches();
+    }
+    else if (Batches_.GetStats().FreeObjects_ < RETIRE_BATCHES / 2)
+    {
+        Drain();
+    }
+    return true;
+}
+
+/**
+ * @brief Frees every retired block the pinned readers allow.
+ * The open batch is closed, however few blocks it holds. With no reader pinned
+ * every retired block is freed.
+ * @return unsigned The number of blocks freed.
+ * @throw OAException Throws an exception if a reclaimed block is rejected by the
+ *        ObjectAllocator.
+ */
+unsigned EpochObjectAllocator::Reclaim()
+{
+    std::lock_guard<std::mutex> guard(Lock_);
+    return Collect();
+}
+
+/**
+ * @brief Pins the current epoch for the calling reader.
+ * Claims a free reader slot with a CAS, starting at the slot the thread used last,
+ * so a thread that pins over and over finds its slot free on the first try. The
+ * epoch is read again once the slot is published: if it moved on in between, the
+ * slot is brought up to date, so the reader never holds a pin older than the epoch
+ * it reads the structure in. When every slot is taken the thread yields and looks
+ * again. Pins may nest; each takes a slot of its own.
+ * @return unsigned The slot, to pass to Unpin.
+ */
+unsigned EpochObjectAllocator::Pin()
+{
+    unsigned long long epoch = Epoch_.load(std::memory_order_seq_cst);
+    for (unsigned slot = ReaderHint, tried = 1;; slot = (slot + 1) % READER_SLOTS, ++tried)
+    {
+        std::atomic<unsigned long long>& state = Readers_[slot].State;
+        unsigned long long empty = 0;
+        if (state.load(std::memory_order_relaxed) == 0 &&
+            state.compare_exchange_strong(empty, epoch << 1 | 1, std::memory_order_seq_cst))
+        {
+            for (unsigned long long now = Epoch_.load(std::memory_order_seq_cst); now != epoch; now = Epoch_.load(std::memory_order_seq_cst))
+            {
+                epoch = now;
+                state.store(epoch << 1 | 1, std::memory_order_seq_cst);
+            }
+            ReaderHint = slot;
+            return slot;
+        }
+
+        if (tried % READER_SLOTS == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * @brief Ends a read: the reader holds no pointer into the structure any more.
+ * @param Slot The slot Pin returned.
+ */
+void EpochObjectAllocator::Unpin(unsigned Slot)
+{
+    Readers_[Slot].State.store(0, std::memory_order_release);
+}
+
+/**
+ * @brief Gets the global epoch.
+ * @return unsigned long long The epoch, which starts at 1 and only grows.
+ */
+unsigned long long EpochObjectAllocator::Epoch() const
+{
+    return Epoch_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of blocks retired and not freed yet.
+ * @return unsigned The blocks waiting in the open and closed batches.
+ */
+unsigned EpochObjectAllocator::Pending() const
+{
+    return Pending_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Releases the pages of the ObjectAllocator that have no block in use.
+ * Retired blocks are still in use until they are reclaimed, so their pages stay.
+ * The batch pool keeps its pages, so Retire never has to make one.
+ * @return unsigned The number of pages of blocks that were freed.
+ */
+unsigned EpochObjectAllocator::FreeEmptyPages()
+{
+    std::lock_guard<std::mutex> guard(Lock_);
+    return Pages_.FreeEmptyPages();
+}
+
+/**
+ * @brief Retrieves the configuration of the blocks' ObjectAllocator.
+ * @return OAConfig The configuration parameters.
+ */
+OAConfig EpochObjectAllocator::GetConfig() const
+{
+    std::lock_guard<std::mutex> guard(Lock_);
+    return Pages_.GetConfig();
+}
+
+/**
+ * @brief Gets the statistics of the blocks' ObjectAllocator.
+ * A retired block is counted in use until it is reclaimed; Pending tells how many
+ * of the blocks in use are retired.
+ * @return OAStats A structure containing the allocator's statistics.
+ */
+OAStats EpochObjectAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> guard(Lock_);
+    return Pages_.GetStats();
+}
+
+/**
+ * @brief Closes the open batch and frees what the readers allow, moving the epoch
+ * on as many times as that takes (twice at most). Lock_ must be held.
+ * @return unsigned The number of blocks freed.
+ * @throw OAException Throws an exception if a reclaimed block is rejected.
+ */
+unsigned EpochObjectAllocator::Collect()
+{
+    Close();
+    return Drain();
+}
+
+/**
+ * @brief Frees the closed batches the readers allow, moving the epoch on as many times
+ * as that takes (twice at most). The open batch stays open. Lock_ must be held.
+ * @return unsigned The number of blocks freed.
+ * @throw OAException Throws an exception if a reclaimed block is rejected.
+ */
+unsigned EpochObjectAllocator::Drain()
+{
+    unsigned freed = FreeSafeBatches();
+    for (int i = 0; i < 2 && Oldest_ && TryAdvance(); ++i)
+    {
+        freed += FreeSafeBatches();
+    }
+    return freed;
+}
+
+/**
+ * @brief Takes a batch from the pool. When all RETIRE_BATCHES are closed and waiting,
+ * the batches the readers allow are freed first. The pool never creates a page.
+ * Lock_ must be held.
+ * @return RetireBatch* An empty batch (its fields are not set), or nullptr while the
+ *         readers still hold every batch.
+ * @throw OAException Throws the exception of a reclaimed block that is rejected.
+ */
+EpochObjectAllocator::RetireBatch* EpochObjectAllocator::TakeBatch()
+{
+    if (Batches_.GetStats().FreeObjects_ == 0)
+    {
+        Drain();
+        if (Batches_.GetStats().FreeObjects_ == 0)
+        {
+            return nullptr;
+        }
+    }
+    return static_cast<RetireBatch*>(Batches_.Allocate());
+}
+
+/**
+ * @brief Closes the open batch, stamping it with the epoch, and queues it behind the
+ * other closed batches. An empty batch stays open. Lock_ must be held.
+ */
+void EpochObjectAllocator::Close()
+{
+    if (!Open_ || Open_->Count == 0)
+    {
+        return;
+    }
+
+    Open_->Epoch = Epoch_.load(std::memory_order_seq_cst);
+    if (Newest_)
+    {
+        Newest_->Next = Open_;
+    }
+    else
+    {
+        Oldest_ = Open_;
+    }
+    Newest_ = Open_;
+    Open_ = nullptr;
+}
+
+/**
+ * @brief Moves the epoch on if every pinned reader has pinned the current one.
+ * Only writers move the epoch, under Lock_, so nobody else can move it between the
+ * scan and the store.
+ * @return bool True if the epoch moved on; otherwise, false.
+ */
+bool EpochObjectAllocator::TryAdvance()
+{
+    unsigned long long epoch = Epoch_.load(std::memory_order_relaxed);
+    for (const ReaderSlot& reader : Readers_)
+    {
+        unsigned long long state = reader.State.load(std::memory_order_seq_cst);
+        if ((state & 1) && (state >> 1) != epoch)
+        {
+            return false;
+        }
+    }
+    Epoch_.store(epoch + 1, std::memory_order_seq_cst);
+    return true;
+}
+
+/**
+ * @brief Frees the closed batches no reader can still see, oldest first.
+ * A batch closed in epoch E holds blocks retired in E or before. The epoch only
+ * reaches E + 2 once every pinned reader has pinned E + 1, after the blocks were
+ * unlinked, so from then on no reader can hold one of them. Lock_ must be held.
+ * @return unsigned The number of blocks freed.
+ * @throw OAException Throws an exception if a reclaimed block is rejected.
+ */
+unsigned EpochObjectAllocator::FreeSafeBatches()
+{
+    unsigned freed = 0;
+    unsigned long long epoch = Epoch_.load(std::memory_order_relaxed);
+    while (Oldest_ && Oldest_->Epoch + 2 <= epoch)
+    {
+        RetireBatch* batch = Oldest_;
+        Oldest_ = batch->Next;
+        if (!Oldest_)
+        {
+            Newest_ = nullptr;
+        }
+        freed += batch->Count;
+        FreeRetired(batch);
+    }
+    return freed;
+}
+
+/**
+ * @brief Gives a batch's blocks back to the ObjectAllocator with one FreeBatch, and
+ * the batch back to the batch pool. If FreeBatch rejects a block (it frees none
+ * then), the valid ones are freed one at a time and the first error is thrown
+ * afterwards, so one bad Retire doesn't leak the rest of its batch.
+ * @param batch A batch already taken off the queue.
+ * @throw OAException Throws the exception of the first invalid block.
+ */
+void EpochObjectAllocator::FreeRetired(RetireBatch* batch)
+{
+    Pending_.store(Pending_.load(std::memory_order_relaxed) - batch->Count, std::memory_order_relaxed);
+    try
+    {
+        Pages_.FreeBatch(batch->Blocks, batch->Count);
+    }
+    catch (const OAException& batchError)
+    {
+        OAException error = batchError;
+        for (unsigned i = 0; i < batch->Count; ++i)
+        {
+            try
+            {
+                Pages_.Free(batch->Blocks[i]);
+            }
+            catch (const OAException&)
+            {
+            }
+        }
+        Batches_.Free(batch);
+        throw error;
+    }
+    Batches_.Free(batch);
+}
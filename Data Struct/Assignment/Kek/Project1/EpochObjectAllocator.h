@@ -0,0 +1,173 @@
+/*!************************************************************************
+\file   EpochObjectAllocator.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  ObjectAllocator for structures that are read without locks: readers pin
+  the current epoch, writers retire blocks instead of freeing them, and
+  retired blocks are freed in batches once no pinned reader can still see
+  them (epoch-based reclamation).
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef EPOCHOBJECTALLOCATORH
+#define EPOCHOBJECTALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/*!
+  Allocator for read-mostly structures whose readers take no lock.
+
+  A reader pins the global epoch for as long as it holds pointers into the
+  structure (Pin/Unpin, or a ReadGuard). Pinning claims one of READER_SLOTS
+  slots with a CAS and writes the epoch into it; no thread has to register.
+  A writer unlinks a block from the structure and Retires it. Retired blocks
+  gather in batches of RETIRE_BATCH, each stamped with the epoch it was
+  closed in. The epoch moves on only when every pinned reader has seen the
+  current one, so two epochs later no reader can hold a block of the batch,
+  and the whole batch goes back to the free list with one FreeBatch.
+
+  The retire batches are blocks of an ObjectAllocator of their own whose
+  pages are mapped from the OS (OSPages_). The constructor creates all
+  RETIRE_BATCHES of them and the pool never grows or shrinks, so the retire
+  queue never calls new or malloc: a batch is taken from the pool's free
+  list, and the batches of reclaimed blocks are returned to it (the blocks
+  themselves go back through ObjectAllocator::FreeBatch). Once half of the
+  batches are waiting, every Retire tries to move the epoch on. When all of
+  them are waiting on the readers, Retire waits for one to come free, which
+  holds the writer back; TryRetire returns false instead.
+
+  Allocate, Free, Retire and Reclaim may be called from any thread; they
+  share one lock, as the ObjectAllocator behind them isn't thread-safe.
+  Pin and Unpin take no lock. Blocks still retired when the allocator is
+  destroyed are released with its pages; no reader may still be pinned.
+*/
+class EpochObjectAllocator
+{
+public:
+    static const unsigned READER_SLOTS = 64;  //!< readers that can be pinned at once (Pin waits for a slot beyond that)
+    static const unsigned RETIRE_BATCH = 61;  //!< retired blocks freed together (a batch is 512 bytes on 64-bit)
+    static const unsigned RETIRE_BATCHES = 248; //!< batches made by the constructor, the most that can wait at once
+
+    /*!
+      Keeps the epoch pinned for the lifetime of a scope
+    */
+    class ReadGuard
+    {
+    public:
+        /*!
+          Pins the epoch
+
+          \param allocator
+            The allocator of the blocks the reader will look at.
+        */
+        explicit ReadGuard(EpochObjectAllocator& allocator) : Allocator_(allocator), Slot_(allocator.Pin()) {}
+
+        /*!
+          Unpins the epoch
+        */
+        ~ReadGuard() { Allocator_.Unpin(Slot_); }
+
+          // Prevent copy construction and assignment
+        ReadGuard(const ReadGuard &guard) = delete;            //!< Do not implement!
+        ReadGuard &operator=(const ReadGuard &guard) = delete; //!< Do not implement!
+
+    private:
+        EpochObjectAllocator& Allocator_; //!< the allocator pinned
+        unsigned Slot_;                   //!< the reader slot Pin claimed
+    };
+
+    // Creates the ObjectAllocator of the blocks and the pool of retire batches
+    // Throws an exception if the construction fails. (Memory allocation problem)
+    EpochObjectAllocator(size_t ObjectSize, const OAConfig& config);
+
+    // Destroys the allocator, its pages and every block still retired (never throws)
+    ~EpochObjectAllocator();
+
+    // Takes a block, reclaiming retired blocks (waiting briefly on the readers) when the page limit is reached
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void* Allocate(const char* label = 0);
+
+    // Frees a block at once; only for blocks no reader can have seen
+    // Throws an exception if the the object can't be freed. (Invalid object)
+    void Free(void* Object);
+
+    // Queues a block unlinked from the structure, to be freed once no reader can hold it,
+    // waiting while the readers hold every batch (so never call it while pinned)
+    // Throws an exception if a reclaimed block is invalid.
+    void Retire(void* Object);
+
+    // Like Retire, but returns false at once, with the block not retired, while the readers
+    // hold every batch. Throws an exception if a reclaimed block is invalid.
+    bool TryRetire(void* Object);
+
+    // Closes the current batch, moves the epoch on if it can and frees the batches that are safe
+    // Returns the number of blocks freed. Throws an exception if a reclaimed block is invalid.
+    unsigned Reclaim();
+
+    // Pins the current epoch for the calling reader and returns the slot to pass to Unpin (never throws)
+    unsigned Pin();
+
+    // Ends the read that Pin started (never throws)
+    void Unpin(unsigned Slot);
+
+    unsigned long long Epoch() const; // the global epoch
+    unsigned Pending() const;         // blocks retired and not freed yet
+    unsigned FreeEmptyPages();        // releases the pages with no objects in use or retired (the batches stay)
+    OAConfig GetConfig() const;       // returns the configuration parameters
+    OAStats GetStats() const;         // returns the statistics (retired blocks count as in use)
+
+      // Prevent copy construction and assignment
+    EpochObjectAllocator(const EpochObjectAllocator &oa) = delete;            //!< Do not implement!
+    EpochObjectAllocator &operator=(const EpochObjectAllocator &oa) = delete; //!< Do not implement!
+
+private:
+    /*!
+      Blocks retired together, freed together two epochs after the batch closed
+    */
+    struct RetireBatch
+    {
+        RetireBatch* Next;                //!< the next batch to close after this one
+        unsigned long long Epoch;         //!< global epoch when the batch closed
+        unsigned Count;                   //!< blocks in the batch
+        void* Blocks[RETIRE_BATCH];       //!< the retired blocks
+    };
+
+    /*!
+      One pinned reader: (epoch << 1) | 1, or 0 when the slot is free.
+      Padded to a cache line so readers don't share one.
+    */
+    struct ReaderSlot
+    {
+        std::atomic<unsigned long long> State;                                             //!< the reader's epoch and pinned bit
+        char Padding[OAConfig::CACHE_LINE_SIZE - sizeof(std::atomic<unsigned long long>)]; //!< keeps the next slot off this line
+    };
+
+    unsigned Collect();
+    unsigned Drain();
+    RetireBatch* TakeBatch();
+    void Close();
+    bool TryAdvance();
+    unsigned FreeSafeBatches();
+    void FreeRetired(RetireBatch* batch);
+
+    ReaderSlot Readers_[READER_SLOTS];      //!< the pinned readers
+    std::atomic<unsigned long long> Epoch_; //!< the global epoch
+    mutable std::mutex Lock_;               //!< serializes the writers (Pages_, Batches_ and the queue)
+    ObjectAllocator Pages_;                 //!< the blocks
+    ObjectAllocator Batches_;               //!< the RETIRE_BATCHES retire batches, on pages mapped from the OS
+    RetireBatch* Open_;                     //!< batch being filled by Retire, or null
+    RetireBatch* Oldest_;                   //!< first closed batch, next to be freed
+    RetireBatch* Newest_;                   //!< last closed batch
+    std::atomic<unsigned> Pending_;         //!< blocks retired and not freed yet
+};
+
+#endif
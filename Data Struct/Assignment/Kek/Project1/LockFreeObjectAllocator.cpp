@@ -0,0 +1,284 @@
+///*!************************************************************************
+//\file   LockFreeObjectAllocator.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "LockFreeObjectAllocator.h"
+
+namespace
+{
+    // Bits of the packed head that hold the pointer. 64-bit targets only use
+    // 48 bits of user-space address, leaving 16 for the tag; 32-bit targets
+    // keep the whole pointer and use the upper 32 bits as the tag.
+    const unsigned POINTER_BITS = sizeof(void*) == 8 ? 48 : 32;
+    const uint64_t POINTER_MASK = (uint64_t(1) << POINTER_BITS) - 1;
+
+    static_assert(sizeof(void*) <= sizeof(uint64_t), "a pointer and its tag must fit in one 64-bit word");
+    static_assert(sizeof(std::atomic<GenericObject*>) == sizeof(GenericObject*) && ATOMIC_POINTER_LOCK_FREE == 2,
+                  "Next is read and written through std::atomic<GenericObject*>");
+
+    /*!
+      Reads a block's Next while another thread may be writing it. A losing
+      Pop reads the Next of a block that has just been handed out, so the
+      access has to be atomic even though the value is then thrown away.
+    */
+    GenericObject* LoadNext(GenericObject* block)
+    {
+        return reinterpret_cast<std::atomic<GenericObject*>*>(&block->Next)->load(std::memory_order_relaxed);
+    }
+
+    /*!
+      Writes a block's Next, atomically for the same reason as LoadNext
+    */
+    void StoreNext(GenericObject* block, GenericObject* next)
+    {
+        reinterpret_cast<std::atomic<GenericObject*>*>(&block->Next)->store(next, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Constructs a LockFreeObjectAllocator.
+ * The internal ObjectAllocator lays out and creates the first page; its blocks
+ * are moved onto the lock-free list.
+ * @param ObjectSize The size of each object to be managed by the allocator.
+ * @param config Configuration settings (page size, padding, alignment, page limit).
+ * @throw OAException Throws an exception if the page can't be made, or if its
+ *        address doesn't fit in the bits the packed head keeps for the pointer.
+ */
+LockFreeObjectAllocator::LockFreeObjectAllocator(size_t ObjectSize, const OAConfig& config)
+    : FreeList_{ 0 }, Allocations_{ 0 }, Deallocations_{ 0 }, MostObjects_{ 0 }, Pages_{ ObjectSize, config }
+{
+    GenericObject* head = Pages_.TakeFreeList();
+    if (head)
+    {
+        GenericObject* tail = head;
+        CheckPointerBits(tail);
+        while (tail->Next)
+        {
+            tail = tail->Next;
+            CheckPointerBits(tail);
+        }
+        Push(head, tail);
+    }
+}
+
+/**
+ * @brief Destructor for the LockFreeObjectAllocator.
+ * The internal ObjectAllocator releases every page.
+ */
+LockFreeObjectAllocator::~LockFreeObjectAllocator()
+{
+}
+
+/**
+ * @brief Allocates a block of memory for an object.
+ * Pops the top of the free list with a single CAS. When the list is empty a new
+ * page is created under the growth lock.
+ * @return void* Pointer to the allocated block of memory.
+ * @throw OAException Throws an exception if memory cannot be allocated due to
+ *        reaching the limit of pages or no system memory available.
+ */
+void* LockFreeObjectAllocator::Allocate()
+{
+    void* block = Pop();
+    if (!block)
+    {
+        block = Grow();
+    }
+
+    unsigned allocations = Allocations_.fetch_add(1, std::memory_order_relaxed) + 1;
+    unsigned inUse = allocations - Deallocations_.load(std::memory_order_relaxed);
+    unsigned most = MostObjects_.load(std::memory_order_relaxed);
+    while (inUse > most && !MostObjects_.compare_exchange_weak(most, inUse, std::memory_order_relaxed))
+    {
+    }
+
+    return block;
+}
+
+/**
+ * @brief Returns a block to the free list.
+ * Pushes with a single CAS, so a Free from any thread never waits on another.
+ * @param Object Pointer to the object to be freed.
+ */
+void LockFreeObjectAllocator::Free(void* Object)
+{
+    if (!Object)
+    {
+        return;
+    }
+
+    GenericObject* block = static_cast<GenericObject*>(Object);
+    Push(block, block);
+    Deallocations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Retrieves the configuration settings of the allocator.
+ * @return OAConfig A copy of the current configuration settings.
+ */
+OAConfig LockFreeObjectAllocator::GetConfig() const
+{
+    std::lock_guard<std::mutex> growGuard(GrowLock_);
+    return Pages_.GetConfig();
+}
+
+/**
+ * @brief Gets the statistics of the allocator.
+ * Sizes and the page count come from the internal ObjectAllocator; the block
+ * counts come from the atomic counters, so they are a consistent snapshot only
+ * when no other thread is allocating or freeing.
+ * @return OAStats A structure containing the allocator's statistics.
+ */
+OAStats LockFreeObjectAllocator::GetStats() const
+{
+    OAStats stats;
+    {
+        std::lock_guard<std::mutex> growGuard(GrowLock_);
+        stats = Pages_.GetStats();
+        stats.FreeObjects_ = Pages_.Capacity();
+    }
+
+    stats.Allocations_ = Allocations_.load(std::memory_order_relaxed);
+    stats.Deallocations_ = Deallocations_.load(std::memory_order_relaxed);
+    stats.ObjectsInUse_ = stats.Allocations_ - stats.Deallocations_;
+    stats.FreeObjects_ -= stats.ObjectsInUse_;
+    stats.MostObjects_ = MostObjects_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Pops the top block off the free list.
+ * The tag is bumped on every successful CAS, so a head that was popped and pushed
+ * back in the meantime no longer compares equal and the stale Next is discarded.
+ * @return GenericObject* The block, or nullptr if the list is empty.
+ */
+GenericObject* LockFreeObjectAllocator::Pop()
+{
+    uint64_t head = FreeList_.load(std::memory_order_acquire);
+    for (;;)
+    {
+        GenericObject* top = Pointer(head);
+        if (!top)
+        {
+            return nullptr;
+        }
+
+        GenericObject* next = LoadNext(top);
+        if (FreeList_.compare_exchange_weak(head, Pack(next, Tag(head) + 1), std::memory_order_acquire, std::memory_order_acquire))
+        {
+            return top;
+        }
+    }
+}
+
+/**
+ * @brief Pushes an already linked chain of blocks onto the free list with one CAS.
+ * @param head First block of the chain.
+ * @param tail Last block of the chain (may be head).
+ */
+void LockFreeObjectAllocator::Push(GenericObject* head, GenericObject* tail)
+{
+    uint64_t top = FreeList_.load(std::memory_order_relaxed);
+    do
+    {
+        StoreNext(tail, Pointer(top));
+    } while (!FreeList_.compare_exchange_weak(top, Pack(head, Tag(top) + 1), std::memory_order_release, std::memory_order_relaxed));
+}
+
+/**
+ * @brief Creates a page and publishes its blocks.
+ * Only one thread grows at a time. After taking the lock the free list is tried
+ * again, since the thread that held it may just have published a page. The new
+ * page's chain is prepared privately; its first block goes to the caller and the
+ * rest is published with a single CAS.
+ * @return void* A block for the caller.
+ * @throw OAException Throws an exception if the page limit is reached, the
+ *        system is out of memory or the page lies above the packed pointer bits.
+ */
+void* LockFreeObjectAllocator::Grow()
+{
+    std::lock_guard<std::mutex> growGuard(GrowLock_);
+
+    GenericObject* block = Pop();
+    if (block)
+    {
+        return block;
+    }
+
+    OAConfig config = Pages_.GetConfig();
+    if (config.MaxPages_ > 0 && Pages_.GetStats().PagesInUse_ >= config.MaxPages_)
+    {
+        throw OAException(OAException::E_NO_PAGES, "Allocate:  You have reached maximum pages limit.");
+    }
+
+    GenericObject* tail = nullptr;
+    block = Pages_.CreatePage(tail);
+    if (!block)
+    {
+        throw OAException(OAException::E_NO_MEMORY, "Allocate: Page holds no objects.");
+    }
+
+    //the page's blocks lie between these two, so they fit when both do
+    CheckPointerBits(block);
+    CheckPointerBits(tail);
+
+    if (block != tail)
+    {
+        Push(block->Next, tail);
+    }
+    return block;
+}
+
+/**
+ * @brief Packs a block pointer and a version tag into one CAS-able word.
+ * @param pointer The block pointer.
+ * @param tag The version tag (only the low bits that fit are kept).
+ * @return uint64_t The packed head.
+ */
+uint64_t LockFreeObjectAllocator::Pack(GenericObject* pointer, uint64_t tag)
+{
+    return (tag << POINTER_BITS) | (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer)) & POINTER_MASK);
+}
+
+/**
+ * @brief Unpacks the block pointer of a packed head.
+ * @param head The packed head.
+ * @return GenericObject* The block pointer.
+ */
+GenericObject* LockFreeObjectAllocator::Pointer(uint64_t head)
+{
+    return reinterpret_cast<GenericObject*>(static_cast<uintptr_t>(head & POINTER_MASK));
+}
+
+/**
+ * @brief Unpacks the version tag of a packed head.
+ * @param head The packed head.
+ * @return uint64_t The version tag.
+ */
+uint64_t LockFreeObjectAllocator::Tag(uint64_t head)
+{
+    return head >> POINTER_BITS;
+}
+
+/**
+ * @brief Makes sure a block's address survives packing.
+ * On 64-bit targets the head keeps 48 bits of the pointer. That covers the user
+ * space of the usual 4-level page tables, but not 5-level paging or tagged pointers,
+ * where a block could otherwise be silently truncated on its way through the list.
+ * @param block A block about to be published.
+ * @throw OAException Throws E_NO_MEMORY if the address has bits above POINTER_BITS.
+ */
+void LockFreeObjectAllocator::CheckPointerBits(const GenericObject* block)
+{
+    if (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(block)) & ~POINTER_MASK)
+    {
+        throw OAException(OAException::E_NO_MEMORY, "Allocate: Page address doesn't fit the tagged free list.");
+    }
+}
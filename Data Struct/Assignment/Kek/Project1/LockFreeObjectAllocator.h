@@ -0,0 +1,76 @@
+/*!************************************************************************
+\file   LockFreeObjectAllocator.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  ObjectAllocator variant whose free list is a lock-free (Treiber) stack.
+  The head is a pointer packed with a version tag, so a block that is popped
+  and pushed back between another thread's read and its CAS (ABA) does not
+  corrupt the list. On 64-bit targets the pointer keeps 48 bits and the tag 16;
+  a page above that range is refused. Only page growth takes a lock.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef LOCKFREEOBJECTALLOCATORH
+#define LOCKFREEOBJECTALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/*!
+  Allocator with a lock-free free list, for Allocate and Free from any thread.
+  Pages come from an internal ObjectAllocator and are only released when the
+  allocator is destroyed, so a stale Next read by a losing thread is always
+  readable memory. No patterns, headers or checks are applied per block: this
+  is the release path, debug builds should use ObjectAllocator.
+*/
+class LockFreeObjectAllocator
+{
+public:
+    // Creates the page source per the specified values and allocates the first page
+    // Throws an exception if the construction fails. (Memory allocation problem)
+    LockFreeObjectAllocator(size_t ObjectSize, const OAConfig& config);
+
+    // Destroys the allocator and all of its pages (never throws)
+    ~LockFreeObjectAllocator();
+
+    // Pops a block off the free list, growing by a page when it is empty
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void* Allocate();
+
+    // Pushes a block onto the free list (never blocks)
+    void Free(void* Object);
+
+    OAConfig GetConfig() const;       // returns the configuration parameters
+    OAStats GetStats() const;         // returns the statistics for the allocator
+
+      // Prevent copy construction and assignment
+    LockFreeObjectAllocator(const LockFreeObjectAllocator &oa) = delete;            //!< Do not implement!
+    LockFreeObjectAllocator &operator=(const LockFreeObjectAllocator &oa) = delete; //!< Do not implement!
+
+private:
+    GenericObject* Pop();
+    void Push(GenericObject* head, GenericObject* tail);
+    void* Grow();
+
+    static uint64_t Pack(GenericObject* pointer, uint64_t tag);
+    static GenericObject* Pointer(uint64_t head);
+    static uint64_t Tag(uint64_t head);
+    static void CheckPointerBits(const GenericObject* block);
+
+    std::atomic<uint64_t> FreeList_;           //!< top of the free list, packed with its version tag
+    std::atomic<unsigned> Allocations_;        //!< total requests to allocate memory
+    std::atomic<unsigned> Deallocations_;      //!< total requests to free memory
+    std::atomic<unsigned> MostObjects_;        //!< most objects in use by client at one time
+    mutable std::mutex GrowLock_;              //!< serializes page growth and reads of Pages_
+    ObjectAllocator Pages_;                    //!< creates, tracks and finally releases the pages
+};
+
+#endif
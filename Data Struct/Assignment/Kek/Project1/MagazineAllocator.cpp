@@ -0,0 +1,506 @@
+///*!************************************************************************
+//\file   MagazineAllocator.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "MagazineAllocator.h"
+#include <atomic>
+#include <unordered_map>
+#include <utility>
+
+/*!
+  The blocks one thread holds on to, plus its share of the statistics.
+  Only the owning thread writes to it outside of DepotLock_; the counters are
+  atomics so GetStats can read them from any thread.
+*/
+struct MagazineAllocator::ThreadCache
+{
+    void** Loaded;                        //!< magazine blocks are taken from and put into
+    unsigned LoadedCount;                 //!< rounds in Loaded
+    void** Previous;                      //!< spare magazine, always completely full or empty
+    unsigned PreviousCount;               //!< rounds in Previous
+    std::atomic<unsigned> Cached;         //!< LoadedCount + PreviousCount, for GetStats
+    std::atomic<unsigned> Allocations;    //!< requests served for this thread
+    std::atomic<unsigned> Deallocations;  //!< frees made by this thread
+    bool Orphaned;                        //!< the thread has exited, the record can be reused
+};
+
+namespace
+{
+    //!< Guards LiveAllocators, taken only on construction, destruction and thread exit
+    std::mutex RegistryLock;
+    //!< Allocators that still exist, by id, so an exiting thread knows whose caches it may touch
+    std::unordered_map<unsigned long long, MagazineAllocator*> LiveAllocators;
+    //!< Source of allocator ids; ids are never reused, unlike addresses
+    std::atomic<unsigned long long> NextId{ 1 };
+
+    /*!
+      Single-writer increment for the per-thread counters
+    */
+    void Bump(std::atomic<unsigned>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+/*!
+  The calling thread's caches, one per allocator it has used. When the thread
+  exits, the blocks it still holds go back to the depots that are still alive.
+*/
+struct MagazineAllocator::ThreadCacheList
+{
+    std::unordered_map<unsigned long long, ThreadCache*> Caches; //!< by allocator id
+    unsigned long long LastId = 0;                               //!< allocator of the last lookup
+    ThreadCache* LastCache = nullptr;                            //!< cache of the last lookup
+
+    /*!
+      Forgets the caches of allocators that have been destroyed since, so a
+      long-lived thread doesn't collect an entry for every allocator it used
+    */
+    void Prune()
+    {
+        std::lock_guard<std::mutex> registryGuard(RegistryLock);
+        for (auto entry = Caches.begin(); entry != Caches.end();)
+        {
+            if (LiveAllocators.count(entry->first))
+            {
+                ++entry;
+            }
+            else
+            {
+                entry = Caches.erase(entry);
+            }
+        }
+    }
+
+    /*!
+      Hands the caches of live allocators back before the thread goes away
+    */
+    ~ThreadCacheList()
+    {
+        std::lock_guard<std::mutex> registryGuard(RegistryLock);
+        for (auto& entry : Caches)
+        {
+            auto live = LiveAllocators.find(entry.first);
+            if (live != LiveAllocators.end())
+            {
+                live->second->ReleaseThreadCache(entry.second);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Constructs a MagazineAllocator.
+ * Builds the depot's ObjectAllocator from the same size and configuration a plain
+ * ObjectAllocator would get and registers the allocator so exiting threads can
+ * return their blocks to it.
+ * @param ObjectSize The size of each object to be managed by the allocator.
+ * @param config Configuration settings for the depot's ObjectAllocator.
+ * @param MagazineSize Number of blocks a magazine holds; a thread exchanges this many at a time.
+ */
+MagazineAllocator::MagazineAllocator(size_t ObjectSize, const OAConfig& config, unsigned MagazineSize)
+    : Depot_{ ObjectSize, config }, MagazineSize_{ MagazineSize ? MagazineSize : 1 }, Id_{ NextId++ },
+      Bypass_{ config.DebugOn_ || config.UseCPPMemManager_ }, MostObjects_{ 0 }
+{
+    std::lock_guard<std::mutex> registryGuard(RegistryLock);
+    LiveAllocators[Id_] = this;
+}
+
+/**
+ * @brief Destructor for the MagazineAllocator.
+ * Unregisters the allocator first, so no exiting thread can reach it any more, then
+ * frees every magazine and thread cache. The depot releases the pages themselves.
+ */
+MagazineAllocator::~MagazineAllocator()
+{
+    {
+        std::lock_guard<std::mutex> registryGuard(RegistryLock);
+        LiveAllocators.erase(Id_);
+    }
+
+    for (ThreadCache* cache : Caches_)
+    {
+        delete[] cache->Loaded;
+        delete[] cache->Previous;
+        delete cache;
+    }
+    for (void** magazine : FullMagazines_)
+    {
+        delete[] magazine;
+    }
+    for (void** magazine : EmptyMagazines_)
+    {
+        delete[] magazine;
+    }
+}
+
+/**
+ * @brief Allocates a block for the calling thread.
+ * The block comes from the thread's loaded magazine. When it is empty the spare
+ * magazine is swapped in if it is full; only when both are empty is the depot
+ * locked, to trade the empty magazine for a full one or to fill it straight from
+ * the ObjectAllocator. With debugging on, or when the C++ memory manager is used,
+ * every call goes to the depot so all of the ObjectAllocator's checks still apply.
+ * @param label Optional label, only passed on when the call goes straight to the depot.
+ * @return void* Pointer to the allocated block of memory.
+ * @throw OAException Throws an exception if the depot cannot supply any block.
+ */
+void* MagazineAllocator::Allocate(const char* label)
+{
+    if (Bypass_)
+    {
+        std::lock_guard<std::mutex> depotGuard(DepotLock_);
+        return Depot_.Allocate(label);
+    }
+
+    ThreadCache* cache = GetThreadCache();
+
+    if (cache->LoadedCount == 0)
+    {
+        if (cache->PreviousCount > 0)
+        {
+            std::swap(cache->Loaded, cache->Previous);
+            std::swap(cache->LoadedCount, cache->PreviousCount);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> depotGuard(DepotLock_);
+            if (!FullMagazines_.empty())
+            {
+                //park the empty spare in the depot, the empty loaded one becomes the spare
+                EmptyMagazines_.push_back(cache->Previous);
+                cache->Previous = cache->Loaded;
+                cache->Loaded = FullMagazines_.back();
+                cache->LoadedCount = MagazineSize_;
+                FullMagazines_.pop_back();
+            }
+            else
+            {
+                //fill the loaded magazine straight from the object allocator, one block
+                //at a time only when a whole magazine would go past the page limit
+                try
+                {
+                    Depot_.AllocateBatch(MagazineSize_, cache->Loaded);
+                    cache->LoadedCount = MagazineSize_;
+                }
+                catch (const OAException& exception)
+                {
+                    if (exception.code() != OAException::E_NO_PAGES)
+                    {
+                        throw;
+                    }
+                }
+                while (cache->LoadedCount < MagazineSize_)
+                {
+                    try
+                    {
+                        cache->Loaded[cache->LoadedCount] = Depot_.Allocate();
+                    }
+                    catch (const OAException&)
+                    {
+                        if (cache->LoadedCount == 0)
+                        {
+                            throw;
+                        }
+                        break;
+                    }
+                    ++cache->LoadedCount;
+                }
+            }
+            cache->Cached.store(cache->LoadedCount + cache->PreviousCount, std::memory_order_relaxed);
+            UpdateMostObjects();
+        }
+    }
+
+    void* block = cache->Loaded[--cache->LoadedCount];
+    cache->Cached.store(cache->LoadedCount + cache->PreviousCount, std::memory_order_relaxed);
+    Bump(cache->Allocations);
+    return block;
+}
+
+/**
+ * @brief Returns a block on behalf of the calling thread.
+ * The block goes into the thread's loaded magazine. When it is full the empty
+ * spare is swapped in; only when both are full is the depot locked to trade the
+ * full spare for an empty magazine. Blocks in magazines are not checked, so turn
+ * debugging on to have every Free validated by the ObjectAllocator.
+ * @param Object Pointer to the object to be freed.
+ * @throw OAException Throws an exception if the depot rejects a block passed straight through.
+ */
+void MagazineAllocator::Free(void* Object)
+{
+    if (!Object)
+    {
+        return;
+    }
+
+    if (Bypass_)
+    {
+        std::lock_guard<std::mutex> depotGuard(DepotLock_);
+        Depot_.Free(Object);
+        return;
+    }
+
+    ThreadCache* cache = GetThreadCache();
+
+    if (cache->LoadedCount == MagazineSize_)
+    {
+        if (cache->PreviousCount == 0)
+        {
+            std::swap(cache->Loaded, cache->Previous);
+            std::swap(cache->LoadedCount, cache->PreviousCount);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> depotGuard(DepotLock_);
+            //park the full spare in the depot, the full loaded one becomes the spare
+            FullMagazines_.push_back(cache->Previous);
+            cache->Previous = cache->Loaded;
+            cache->PreviousCount = MagazineSize_;
+            cache->Loaded = TakeEmptyMagazine();
+            cache->LoadedCount = 0;
+        }
+    }
+
+    cache->Loaded[cache->LoadedCount++] = Object;
+    cache->Cached.store(cache->LoadedCount + cache->PreviousCount, std::memory_order_relaxed);
+    Bump(cache->Deallocations);
+}
+
+/**
+ * @brief Returns the calling thread's cached blocks to the depot.
+ * The blocks go back onto the ObjectAllocator's free list, so their pages can be
+ * released by FreeEmptyPages. The thread keeps its (now empty) magazines.
+ */
+void MagazineAllocator::Flush()
+{
+    if (Bypass_)
+    {
+        return;
+    }
+
+    ThreadCache* cache = GetThreadCache();
+    std::lock_guard<std::mutex> depotGuard(DepotLock_);
+    ReturnRounds(cache->Loaded, cache->LoadedCount);
+    ReturnRounds(cache->Previous, cache->PreviousCount);
+    cache->LoadedCount = 0;
+    cache->PreviousCount = 0;
+    cache->Cached.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Frees the depot's empty pages.
+ * Full magazines parked in the depot are emptied first so their blocks count as free.
+ * Blocks still cached by threads keep their pages in use.
+ * @return unsigned The number of pages that were freed.
+ */
+unsigned MagazineAllocator::FreeEmptyPages()
+{
+    std::lock_guard<std::mutex> depotGuard(DepotLock_);
+    for (void** magazine : FullMagazines_)
+    {
+        ReturnRounds(magazine, MagazineSize_);
+        EmptyMagazines_.push_back(magazine);
+    }
+    FullMagazines_.clear();
+    return Depot_.FreeEmptyPages();
+}
+
+/**
+ * @brief Retrieves the configuration of the depot's ObjectAllocator.
+ * @return OAConfig A copy of the current configuration settings.
+ */
+OAConfig MagazineAllocator::GetConfig() const
+{
+    std::lock_guard<std::mutex> depotGuard(DepotLock_);
+    return Depot_.GetConfig();
+}
+
+/**
+ * @brief Gets the statistics of the allocator as a whole.
+ * The depot counts every block sitting in a magazine as in use, so those are moved
+ * back to the free count, and the client's allocations and frees are summed over
+ * the thread caches. MostObjects_ is sampled whenever a thread exchanges with the
+ * depot and here, so it can lag the true peak by at most one magazine per thread.
+ * @return OAStats A structure containing the allocator's statistics.
+ */
+OAStats MagazineAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> depotGuard(DepotLock_);
+    OAStats stats = Depot_.GetStats();
+    if (Bypass_)
+    {
+        return stats;
+    }
+
+    unsigned cached = CachedObjects();
+    stats.FreeObjects_ += cached;
+    stats.ObjectsInUse_ -= cached;
+
+    stats.Allocations_ = 0;
+    stats.Deallocations_ = 0;
+    for (const ThreadCache* cache : Caches_)
+    {
+        stats.Allocations_ += cache->Allocations.load(std::memory_order_relaxed);
+        stats.Deallocations_ += cache->Deallocations.load(std::memory_order_relaxed);
+    }
+
+    UpdateMostObjects();
+    stats.MostObjects_ = MostObjects_;
+    return stats;
+}
+
+/**
+ * @brief Finds (or creates) the calling thread's cache for this allocator.
+ * The last lookup is remembered, so the common case is a single comparison.
+ * A new cache reuses the record of a thread that has exited when there is one.
+ * Before one is made, the thread drops its entries for allocators that are gone.
+ * @return ThreadCache* The calling thread's cache.
+ */
+MagazineAllocator::ThreadCache* MagazineAllocator::GetThreadCache()
+{
+    static thread_local ThreadCacheList list;
+    if (list.LastId == Id_)
+    {
+        return list.LastCache;
+    }
+
+    auto found = list.Caches.find(Id_);
+    if (found == list.Caches.end())
+    {
+        list.Prune();
+        found = list.Caches.emplace(Id_, nullptr).first;
+    }
+
+    ThreadCache*& cache = found->second;
+    if (!cache)
+    {
+        std::lock_guard<std::mutex> depotGuard(DepotLock_);
+        for (ThreadCache* candidate : Caches_)
+        {
+            if (candidate->Orphaned)
+            {
+                candidate->Orphaned = false;
+                cache = candidate;
+                break;
+            }
+        }
+        if (!cache)
+        {
+            cache = new ThreadCache{ new void* [MagazineSize_], 0, new void* [MagazineSize_], 0, {0}, {0}, {0}, false };
+            Caches_.push_back(cache);
+        }
+    }
+
+    list.LastId = Id_;
+    list.LastCache = cache;
+    return cache;
+}
+
+/**
+ * @brief Takes back the cache of a thread that is exiting.
+ * Its blocks go back to the ObjectAllocator and the record is kept (with its
+ * counters) for the next new thread. This runs in a thread_local destructor, so
+ * it must not throw: when FreeBatch rejects a magazine its blocks are freed one
+ * at a time instead, and the ones the ObjectAllocator rejects (a block the client
+ * freed twice, say) are dropped.
+ * @param cache The exiting thread's cache.
+ */
+void MagazineAllocator::ReleaseThreadCache(ThreadCache* cache)
+{
+    std::lock_guard<std::mutex> depotGuard(DepotLock_);
+    ReturnRoundsSafely(cache->Loaded, cache->LoadedCount);
+    ReturnRoundsSafely(cache->Previous, cache->PreviousCount);
+    cache->LoadedCount = 0;
+    cache->PreviousCount = 0;
+    cache->Cached.store(0, std::memory_order_relaxed);
+    cache->Orphaned = true;
+}
+
+/**
+ * @brief Frees the blocks of a magazine back to the ObjectAllocator. DepotLock_ must be held.
+ * @param rounds The magazine.
+ * @param count Number of blocks in it.
+ */
+void MagazineAllocator::ReturnRounds(void** rounds, unsigned count)
+{
+    Depot_.FreeBatch(rounds, count);
+}
+
+/**
+ * @brief Frees the blocks of a magazine back to the ObjectAllocator without throwing. DepotLock_ must be held.
+ * Falls back to Free, block by block, when FreeBatch rejects the magazine as a whole,
+ * so only the blocks that are actually bad are lost.
+ * @param rounds The magazine.
+ * @param count Number of blocks in it.
+ */
+void MagazineAllocator::ReturnRoundsSafely(void** rounds, unsigned count)
+{
+    try
+    {
+        ReturnRounds(rounds, count);
+        return;
+    }
+    catch (...)
+    {
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        try
+        {
+            Depot_.Free(rounds[i]);
+        }
+        catch (...)
+        {
+        }
+    }
+}
+
+/**
+ * @brief Gets an empty magazine array from the depot, making one if none is spare. DepotLock_ must be held.
+ * @return void** An empty magazine.
+ */
+void** MagazineAllocator::TakeEmptyMagazine()
+{
+    if (EmptyMagazines_.empty())
+    {
+        return new void* [MagazineSize_];
+    }
+    void** magazine = EmptyMagazines_.back();
+    EmptyMagazines_.pop_back();
+    return magazine;
+}
+
+/**
+ * @brief Counts the blocks held in magazines, in the depot and in every thread. DepotLock_ must be held.
+ * @return unsigned The number of cached blocks.
+ */
+unsigned MagazineAllocator::CachedObjects() const
+{
+    unsigned cached = static_cast<unsigned>(FullMagazines_.size()) * MagazineSize_;
+    for (const ThreadCache* cache : Caches_)
+    {
+        cached += cache->Cached.load(std::memory_order_relaxed);
+    }
+    return cached;
+}
+
+/**
+ * @brief Samples the number of objects in use into MostObjects_. DepotLock_ must be held.
+ */
+void MagazineAllocator::UpdateMostObjects() const
+{
+    unsigned inUse = Depot_.GetStats().ObjectsInUse_ - CachedObjects();
+    if (inUse > MostObjects_)
+    {
+        MostObjects_ = inUse;
+    }
+}
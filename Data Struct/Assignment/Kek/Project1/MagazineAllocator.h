@@ -0,0 +1,85 @@
+/*!************************************************************************
+\file   MagazineAllocator.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Thread-safe front end for ObjectAllocator. Every thread keeps two small
+  magazines (stacks) of free blocks and only touches the shared depot, which
+  owns the ObjectAllocator, when both are empty or both are full.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef MAGAZINEALLOCATORH
+#define MAGAZINEALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <mutex>
+#include <vector>
+
+// If the client doesn't specify it:
+static const unsigned DEFAULT_MAGAZINE_SIZE = 32;
+
+/*!
+  Concurrent allocator that caches blocks per thread in front of an ObjectAllocator
+*/
+class MagazineAllocator
+{
+public:
+    // Creates the depot's ObjectAllocator per the specified values
+    // Throws an exception if the construction fails. (Memory allocation problem)
+    MagazineAllocator(size_t ObjectSize, const OAConfig& config, unsigned MagazineSize = DEFAULT_MAGAZINE_SIZE);
+
+    // Returns every cached block and destroys the depot (never throws)
+    ~MagazineAllocator();
+
+    // Takes a block from the calling thread's magazine, refilling it from the depot when empty
+    // Throws an exception if the depot can't supply a block. (Memory allocation problem)
+    void* Allocate(const char* label = 0);
+
+    // Puts a block into the calling thread's magazine, exchanging it with the depot when full
+    // Throws an exception if the depot rejects the block (only when it is passed straight through)
+    void Free(void* Object);
+
+    // Returns the calling thread's cached blocks to the depot (e.g. before the thread goes idle)
+    void Flush();
+
+    // Frees all empty pages of the depot (cached blocks keep their pages alive)
+    unsigned FreeEmptyPages();
+
+    OAConfig GetConfig() const;       // returns the configuration parameters of the depot
+    OAStats GetStats() const;         // returns the statistics summed over the depot and every thread
+
+      // Prevent copy construction and assignment
+    MagazineAllocator(const MagazineAllocator &ma) = delete;            //!< Do not implement!
+    MagazineAllocator &operator=(const MagazineAllocator &ma) = delete; //!< Do not implement!
+
+private:
+    struct ThreadCache;
+    struct ThreadCacheList;
+    friend struct ThreadCacheList;
+
+    ThreadCache* GetThreadCache();
+    void ReleaseThreadCache(ThreadCache* cache);
+    void ReturnRounds(void** rounds, unsigned count);
+    void ReturnRoundsSafely(void** rounds, unsigned count);
+    void** TakeEmptyMagazine();
+    unsigned CachedObjects() const;
+    void UpdateMostObjects() const;
+
+    mutable std::mutex DepotLock_;           //!< guards the depot, magazines and cache list below
+    ObjectAllocator Depot_;                  //!< the pages and free list every magazine is filled from
+    std::vector<void**> FullMagazines_;      //!< magazines of free blocks waiting in the depot
+    std::vector<void**> EmptyMagazines_;     //!< spare magazine arrays
+    std::vector<ThreadCache*> Caches_;       //!< every thread cache created for this allocator
+    unsigned MagazineSize_;                  //!< rounds (blocks) per magazine
+    unsigned long long Id_;                  //!< identifies this allocator in the threads' cache lists
+    bool Bypass_;                            //!< debugging or new/delete: every call goes to the depot
+    mutable unsigned MostObjects_;           //!< most objects in use, sampled at depot exchanges
+};
+
+#endif
@@ -0,0 +1,320 @@
+///*!************************************************************************
+//\file   OSPageProvider.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "OSPageProvider.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /*!
+      Size of the pages the OS maps and discards
+    */
+    size_t OSPageSize()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        long size = sysconf(_SC_PAGESIZE);
+        return size > 0 ? static_cast<size_t>(size) : 4096;
+#endif
+    }
+
+    /*!
+      Smallest power of two that is at least size
+    */
+    size_t PowerOfTwo(size_t size)
+    {
+        size_t power = 1;
+        while (power < size)
+        {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    /*!
+      Maps size bytes of zero-filled memory aligned on size (a power of two).
+      Explicit huge pages are tried first when huge is set; large tells which
+      one was used. Returns nullptr when the OS refuses.
+    */
+    char* MapAligned(size_t size, bool huge, bool& large)
+    {
+        large = false;
+#ifdef _WIN32
+        if (huge && GetLargePageMinimum() == size)
+        {
+            // needs SeLockMemoryPrivilege, large pages come aligned on their size
+            void* memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (memory)
+            {
+                large = true;
+                return static_cast<char*>(memory);
+            }
+        }
+
+        // reserve more than needed to find an aligned address, then map exactly there
+        for (int attempt = 0; attempt < 8; ++attempt)
+        {
+            void* probe = VirtualAlloc(nullptr, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+            if (!probe)
+            {
+                return nullptr;
+            }
+            uintptr_t aligned = (reinterpret_cast<uintptr_t>(probe) + size - 1) & ~(static_cast<uintptr_t>(size) - 1);
+            VirtualFree(probe, 0, MEM_RELEASE);
+
+            void* memory = VirtualAlloc(reinterpret_cast<void*>(aligned), size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (memory)
+            {
+                return static_cast<char*>(memory);
+            }
+        }
+        return nullptr;
+#else
+#ifdef MAP_HUGETLB
+        if (huge)
+        {
+            // explicit huge pages only exist if the administrator reserved some
+            void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (memory != MAP_FAILED)
+            {
+                large = true;
+                return static_cast<char*>(memory);
+            }
+        }
+#endif
+        // over-map by the alignment and trim both ends
+        char* memory = static_cast<char*>(mmap(nullptr, size * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (memory == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(memory) + size - 1) & ~(static_cast<uintptr_t>(size) - 1));
+        if (aligned > memory)
+        {
+            munmap(memory, static_cast<size_t>(aligned - memory));
+        }
+        munmap(aligned + size, static_cast<size_t>(memory + size * 2 - (aligned + size)));
+
+#ifdef MADV_HUGEPAGE
+        if (huge)
+        {
+            // transparent huge pages, a hint the kernel may ignore
+            madvise(aligned, size, MADV_HUGEPAGE);
+        }
+#endif
+        return aligned;
+#endif
+    }
+}
+
+/**
+ * @brief Constructs an OSPageProvider.
+ * Works out the slot and chunk sizes; chunks are mapped on demand.
+ * @param PageSize The bytes each page needs.
+ * @param HugePages True to back the chunks with huge pages when the system allows.
+ */
+OSPageProvider::OSPageProvider(size_t PageSize, bool HugePages) : HugePages_{ HugePages }
+{
+    size_t osPage = OSPageSize();
+    SlotSize_ = (std::max<size_t>(PageSize, 1) + osPage - 1) / osPage * osPage;
+    size_t minimum = HugePages_ ? HUGE_PAGE_SIZE : CHUNK_SIZE;
+    ChunkSize_ = PowerOfTwo(SlotSize_ > minimum ? SlotSize_ : minimum);
+}
+
+/**
+ * @brief Destructor for the OSPageProvider.
+ * Unmaps every chunk in one call each, without discarding slots one by one.
+ */
+OSPageProvider::~OSPageProvider()
+{
+    for (auto& chunk : Chunks_)
+    {
+        Unmap(&chunk.second);
+    }
+}
+
+/**
+ * @brief Hands out a zero-filled slot.
+ * Slots come from the chunk that was last given a slot back, or from a newly mapped chunk.
+ * @return char* The slot.
+ * @throw std::bad_alloc If the OS has no memory to give.
+ */
+char* OSPageProvider::Allocate()
+{
+    if (Available_.empty())
+    {
+        Available_.push_back(NewChunk());
+    }
+
+    Chunk* chunk = Available_.back();
+    char* page = chunk->FreeSlots.back();
+    chunk->FreeSlots.pop_back();
+    ++chunk->Used;
+    if (chunk->FreeSlots.empty())
+    {
+        Available_.pop_back();
+    }
+
+#ifdef _WIN32
+    // a released slot is decommitted; committing again gives zeroed memory
+    if (!chunk->Large && !VirtualAlloc(page, SlotSize_, MEM_COMMIT, PAGE_READWRITE))
+    {
+        chunk->FreeSlots.push_back(page);
+        --chunk->Used;
+        if (chunk->FreeSlots.size() == 1)
+        {
+            Available_.push_back(chunk);
+        }
+        throw std::bad_alloc();
+    }
+#endif
+    return page;
+}
+
+/**
+ * @brief Gives a slot back and returns its memory to the OS.
+ * The slot's physical pages are discarded so the resident size shrinks; when it
+ * was the chunk's last slot in use, the whole chunk is unmapped.
+ * @param page A slot from Allocate (nullptr is ignored).
+ */
+void OSPageProvider::Release(char* page)
+{
+    if (!page)
+    {
+        return;
+    }
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(page) & ~(static_cast<uintptr_t>(ChunkSize_) - 1);
+    auto found = Chunks_.find(base);
+    if (found == Chunks_.end())
+    {
+        return;
+    }
+    Chunk* chunk = &found->second;
+
+    if (--chunk->Used == 0)
+    {
+        Available_.erase(std::remove(Available_.begin(), Available_.end(), chunk), Available_.end());
+        Unmap(chunk);
+        Chunks_.erase(found);
+        return;
+    }
+
+    if (chunk->Large)
+    {
+        // huge pages cannot be split, keep the memory but hand it out zeroed
+        std::memset(page, 0, SlotSize_);
+    }
+    else
+    {
+#ifdef _WIN32
+        VirtualFree(page, SlotSize_, MEM_DECOMMIT);
+#elif defined(MADV_DONTNEED) && defined(__linux__)
+        // private anonymous memory reads back as zero after MADV_DONTNEED on Linux
+        madvise(page, SlotSize_, MADV_DONTNEED);
+#else
+        // elsewhere MADV_DONTNEED may keep the contents, so map fresh zero pages over the slot
+        mmap(page, SlotSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+#endif
+    }
+
+    chunk->FreeSlots.push_back(page);
+    if (chunk->FreeSlots.size() == 1)
+    {
+        Available_.push_back(chunk);
+    }
+}
+
+/**
+ * @brief Gets the bytes reserved for each page.
+ * @return size_t The slot size, a whole number of OS pages.
+ */
+size_t OSPageProvider::SlotSize() const
+{
+    return SlotSize_;
+}
+
+/**
+ * @brief Gets the bytes currently mapped from the OS (resident or not).
+ * @return size_t Number of chunks times the chunk size.
+ */
+size_t OSPageProvider::MappedBytes() const
+{
+    return Chunks_.size() * ChunkSize_;
+}
+
+/**
+ * @brief Maps a chunk and cuts it into free slots.
+ * @return Chunk* The new chunk, with every slot free.
+ * @throw std::bad_alloc If the OS has no memory to give.
+ */
+OSPageProvider::Chunk* OSPageProvider::NewChunk()
+{
+    bool large = false;
+    char* base = MapAligned(ChunkSize_, HugePages_, large);
+    if (!base)
+    {
+        throw std::bad_alloc();
+    }
+
+    Chunk& chunk = Chunks_[reinterpret_cast<uintptr_t>(base)];
+    chunk.Base = base;
+    chunk.Used = 0;
+    chunk.Large = large;
+    try
+    {
+        // lowest slot last, so slots are handed out in address order
+        size_t slots = ChunkSize_ / SlotSize_;
+        chunk.FreeSlots.reserve(slots);
+        for (size_t i = slots; i-- > 0;)
+        {
+            chunk.FreeSlots.push_back(base + i * SlotSize_);
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        Unmap(&chunk);
+        Chunks_.erase(reinterpret_cast<uintptr_t>(base));
+        throw;
+    }
+    return &chunk;
+}
+
+/**
+ * @brief Returns a whole chunk to the OS.
+ * @param chunk The chunk (its record is left for the caller to erase).
+ */
+void OSPageProvider::Unmap(Chunk* chunk)
+{
+#ifdef _WIN32
+    VirtualFree(chunk->Base, 0, MEM_RELEASE);
+#else
+    munmap(chunk->Base, ChunkSize_);
+#endif
+}
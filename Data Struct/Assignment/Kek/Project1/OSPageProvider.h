@@ -0,0 +1,89 @@
+/*!************************************************************************
+\file   OSPageProvider.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Page memory taken straight from the operating system (mmap on POSIX,
+  VirtualAlloc on Windows) instead of operator new, so released pages
+  really leave the process.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef OSPAGEPROVIDERH
+#define OSPAGEPROVIDERH
+//---------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*!
+  Hands out zero-filled, fixed-size page slots carved from chunks mapped
+  from the OS.
+
+  A chunk is a power of two in size and aligned on its size, so the chunk of
+  any slot is the slot address masked down. Slots are rounded up to whole OS
+  pages, which makes a released slot exactly the range handed back to the
+  kernel (madvise(MADV_DONTNEED) / MEM_DECOMMIT); the next use of the slot
+  reads zero again. A chunk whose slots are all released is unmapped.
+
+  With huge pages the chunks are 2 MB (or more) and are backed by explicit
+  huge pages when the system has them reserved, otherwise by transparent
+  huge pages where the system supports them. Slots of explicit huge pages
+  cannot be given back one at a time; they are zeroed on release instead and
+  the memory goes back when the whole chunk is free.
+*/
+class OSPageProvider
+{
+public:
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; //!< chunk size with huge pages
+    static const size_t CHUNK_SIZE = 64 * 1024;           //!< smallest chunk size otherwise
+
+    // Prepares slots of at least PageSize bytes (nothing is mapped yet)
+    OSPageProvider(size_t PageSize, bool HugePages);
+
+    // Unmaps every chunk, whether or not its slots were released (never throws)
+    ~OSPageProvider();
+
+    // Returns a zero-filled slot of SlotSize() bytes, aligned on SlotSize() when it is a power of two
+    // Throws std::bad_alloc when the OS has no memory to give.
+    char* Allocate();
+
+    // Gives a slot from Allocate back; its memory is returned to the OS
+    void Release(char* page);
+
+    size_t SlotSize() const;    // bytes reserved for each page
+    size_t MappedBytes() const; // bytes currently mapped from the OS
+
+      // Prevent copy construction and assignment
+    OSPageProvider(const OSPageProvider &provider) = delete;            //!< Do not implement!
+    OSPageProvider &operator=(const OSPageProvider &provider) = delete; //!< Do not implement!
+
+private:
+    /*!
+      One mapping from the OS, cut into slots
+    */
+    struct Chunk
+    {
+        char* Base;                   //!< start of the mapping, aligned on ChunkSize_
+        std::vector<char*> FreeSlots; //!< slots not handed out, lowest address last
+        unsigned Used;                //!< slots handed out
+        bool Large;                   //!< backed by explicit huge pages (cannot be decommitted)
+    };
+
+    Chunk* NewChunk();
+    void Unmap(Chunk* chunk);
+
+    size_t SlotSize_;                                //!< page size rounded up to whole OS pages
+    size_t ChunkSize_;                               //!< power of two holding at least one slot
+    bool HugePages_;                                 //!< back chunks with huge pages when possible
+    std::unordered_map<uintptr_t, Chunk> Chunks_;    //!< every mapped chunk, keyed by its base
+    std::vector<Chunk*> Available_;                  //!< chunks that still have free slots
+};
+
+#endif
@@ -10,8 +10,17 @@
 //\brief
 //**************************************************************************/
 #include "ObjectAllocator.h"
+#include "OSPageProvider.h"
+#include "PatternScan.h"
 #include <iostream>
 #include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <system_error>
 #include <stdio.h>
 
 
@@ -32,81 +41,147 @@
 ObjectAllocator::ObjectAllocator(size_t ObjectSize, const OAConfig& config) :PageList_{ nullptr }, FreeList_{ nullptr }, Config_{ config }, Stats_{}
 {
     Stats_.ObjectSize_ = ObjectSize;
-    const size_t pointer_size = sizeof(void*);
+    //the page layout: the client's page header sits right after the page link and counts
+    //as part of it, and with alignment each block (header, pads and object) is padded so
+    //the next one starts aligned
+    const OALayout layout(Stats_.ObjectSize_, Config_.ObjectsPerPage_, Config_.HBlockInfo_.size_, Config_.PadBytes_,
+        Config_.Alignment_, Config_.PageHeaderSize_);
+    Config_.LeftAlignSize_ = static_cast<unsigned int>(layout.LeftAlignSize_);
+    Config_.InterAlignSize_ = static_cast<unsigned int>(layout.InterAlignSize_);
+    Stats_.PageSize_ = layout.PageSize_;
+
+    //colored pages leave room to shift their blocks by up to Colors_ - 1 steps,
+    //a step being whole cache lines that keep the blocks aligned
+    if (Config_.Colors_ > 1)
+    {
+        ColorStep_ = OAConfig::CACHE_LINE_SIZE;
+        while (Config_.Alignment_ > 0 && ColorStep_ % Config_.Alignment_ != 0)
+        {
+            ColorStep_ += OAConfig::CACHE_LINE_SIZE;
+        }
+        Stats_.PageSize_ += (Config_.Colors_ - 1) * ColorStep_;
+    }
 
-    //calculate the size of the middle block including header, object, and padding
-    size_t midBlock = Config_.HBlockInfo_.size_ + (2 * Config_.PadBytes_) + Stats_.ObjectSize_;
+    //an arena needs a known number of pages, and OS pages come from the page provider
+    if (Config_.MaxPages_ == 0 || Config_.OSPages_ || Config_.HugePages_ || Config_.UseCPPMemManager_)
+    {
+        Config_.Arena_ = false;
+    }
+
+    //growing pages only works where each page can have a size of its own
+    if (Config_.MaxObjectsPerPage_ <= Config_.ObjectsPerPage_ || Config_.AlignPages_ || Config_.OSPages_ ||
+        Config_.HugePages_ || Config_.UseCPPMemManager_ || Config_.Arena_)
+    {
+        Config_.MaxObjectsPerPage_ = 0;
+    }
 
-    //if alignment is required, adjust the middle block size
-    if (Config_.Alignment_ > 0)
+    //handles: enough slot bits for the biggest page and page bits for MaxPages_ pages, the
+    //generation getting the rest (at most 16); without a page limit the generation gets
+    //HANDLE_GENERATION_BITS and the pages the rest
+    unsigned maxBlocks = Config_.MaxObjectsPerPage_ ? Config_.MaxObjectsPerPage_ : Config_.ObjectsPerPage_;
+    while (HandleSlotBits_ < 32 && (1ull << HandleSlotBits_) < maxBlocks)
+    {
+        ++HandleSlotBits_;
+    }
+    unsigned handleBitsLeft = 32 - HandleSlotBits_;
+    if (Config_.MaxPages_ > 0)
+    {
+        while (HandlePageBits_ < 32 && (1ull << HandlePageBits_) < Config_.MaxPages_)
+        {
+            ++HandlePageBits_;
+        }
+        HandleGenerationBits_ = handleBitsLeft > HandlePageBits_ ? std::min(handleBitsLeft - HandlePageBits_, 16u) : 0;
+    }
+    else
     {
-        size_t lfAlight = CalculatePadding(pointer_size + Config_.HBlockInfo_.size_ + Config_.PadBytes_, Config_.Alignment_);
-        Config_.LeftAlignSize_ = static_cast<unsigned int>(lfAlight);
-        size_t lfAlight2 = CalculatePadding(midBlock, Config_.Alignment_);
-        Config_.InterAlignSize_ = static_cast<unsigned int>(lfAlight2);
+        HandleGenerationBits_ = std::min(handleBitsLeft, HANDLE_GENERATION_BITS + 0);
+        HandlePageBits_ = handleBitsLeft - HandleGenerationBits_;
+    }
 
-        //adjust the block size to include the inter-object alignment padding
-        midBlock += Config_.InterAlignSize_;
+    //where blocks sit inside a page, used to turn an address into a block index
+    FirstBlockOffset_ = layout.FirstBlockOffset_;
+    BlockStride_ = layout.BlockStride_;
+
+    //aligned pages reserve the next power of two so the page base is address & ~(footprint - 1)
+    PageFootprint_ = Stats_.PageSize_;
+    if (Config_.AlignPages_)
+    {
+        PageFootprint_ = sizeof(void*);
+        while (PageFootprint_ < Stats_.PageSize_)
+        {
+            PageFootprint_ <<= 1;
+        }
     }
 
-    //calculate total page size
-    Stats_.PageSize_ = CalculateTotalPageSize(pointer_size, Config_.LeftAlignSize_, midBlock,
-        Config_.ObjectsPerPage_, Config_.InterAlignSize_);
+    //OS pages are whole OS pages, which may make the footprint bigger
+    if (Config_.OSPages_ || Config_.HugePages_)
+    {
+        try
+        {
+            PageProvider_ = new OSPageProvider(PageFootprint_, Config_.HugePages_);
+        }
+        catch (const std::bad_alloc&)
+        {
+            throw OAException(OAException::E_NO_MEMORY, "ObjectAllocator: No system memory available.");
+        }
+        PageFootprint_ = PageProvider_->SlotSize();
+    }
 
     if (!Config_.UseCPPMemManager_)
     {
         try
         {
+            //one bin per live count, from empty to full
+            if (Config_.SlabPages_)
+            {
+                Bins_.assign((Config_.MaxObjectsPerPage_ ? Config_.MaxObjectsPerPage_ : Config_.ObjectsPerPage_) + 1, nullptr);
+            }
+
+            //external headers come off pages of their own instead of the heap
+            if (Config_.HBlockInfo_.type_ == OAConfig::hbExternal)
+            {
+                HeaderPool_ = new ObjectAllocator(sizeof(MemBlockInfo), OAConfig(false, HEADERS_PER_PAGE, 0));
+                FreeHeaders_ = HeaderPool_->TakeFreeList();
+            }
+
+            //one region holds every page slot; aligned pages need one slot more to align the first
+            if (Config_.Arena_)
+            {
+                size_t slots = Config_.MaxPages_ + (Config_.AlignPages_ ? 1 : 0);
+                ArenaMemory_ = new char[slots * PageFootprint_];
+                ArenaBase_ = ArenaMemory_;
+                if (Config_.AlignPages_)
+                {
+                    uintptr_t mask = static_cast<uintptr_t>(PageFootprint_) - 1;
+                    ArenaBase_ = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(ArenaMemory_) + mask) & ~mask);
+                }
+                ArenaPages_.assign(Config_.MaxPages_, nullptr);
+                for (unsigned slot = Config_.MaxPages_; slot > 0; --slot)
+                {
+                    ArenaFree_.push_back(slot - 1);
+                }
+            }
+
             AllocateNewPage();
         }
         catch (OAException& exception)
         {
+            delete HeaderPool_;
+            delete PageProvider_;
+            delete[] ArenaMemory_;
             throw(exception);
         }
+        catch (const std::bad_alloc&)
+        {
+            delete HeaderPool_;
+            delete PageProvider_;
+            delete[] ArenaMemory_;
+            throw OAException(OAException::E_NO_MEMORY, "ObjectAllocator: No system memory available.");
+        }
     }
 
 }
 
-/**
- * @brief Calculates the total page size needed based on configuration and object size.
- * This function computes the total size of a page, including space for the object, header,
- * padding, alignment, and pointers for list management. It ensures that the page layout adheres
- * to the specified alignment and padding requirements. 
- * @param pointerSize Size of a pointer, used for page list link.
- * @param leftAlignSize Size of left alignment padding.
- * @param block_size Size of a single block, including object, header, and padding.
- * @param objectsPerPage Number of objects per page.
- * @param interAlignSize Size of alignment padding between objects.
- * @return size_t The total size of a page in bytes.
- */
-size_t ObjectAllocator::CalculateTotalPageSize(size_t pointerSize, size_t leftAlignSize, size_t block_size, size_t objectsPerPage,
-    size_t interAlignSize) const
-{
-    size_t pageSize = pointerSize + leftAlignSize;
-    pageSize += block_size * objectsPerPage;
-    if (objectsPerPage > 1)
-    { //subtract inter-object alignment for the last object
-        pageSize -= interAlignSize;
-    }
-    return pageSize;
-}
-
-/**
- * @brief Calculates the padding needed to satisfy the alignment requirement.
- * This utility function computes how much padding is required to align the next block
- * or structure according to the specified alignment. It is used to ensure that all objects
- * and headers are correctly aligned in memory.
- * @param size Current size before alignment.
- * @param alignment Required alignment boundary.
- * @return size_t The size of padding in bytes needed to achieve the alignment.
- */
-size_t ObjectAllocator::CalculatePadding(size_t size, size_t alignment)
-{
-    size_t padding = alignment - (size % alignment);
-    return (padding == alignment) ? 0 : padding;
-}
-
-
 //Destructor
 //Destroys the object manager
 /**
@@ -116,12 +191,19 @@ size_t ObjectAllocator::CalculatePadding(size_t size, size_t alignment)
  */
 ObjectAllocator::~ObjectAllocator()
 {
-    while (PageList_ != NULL)
+    for (PageInfo* page : Pages_)
     {
-        GenericObject* temp = PageList_->Next;
-        delete[] PageList_;
-        PageList_ = temp;
+        //the page provider and the arena release all of their memory at once
+        if (!PageProvider_ && !ArenaMemory_)
+        {
+            FreePageMemory(page->Page);
+        }
+        delete page;
     }
+    delete PageProvider_;
+    delete[] ArenaMemory_;
+    //releases the external headers of blocks never freed too
+    delete HeaderPool_;
 }
 
 
@@ -177,9 +259,26 @@ void* ObjectAllocator::Allocate(const char* label)
         AllocateNewPage();
     }
 
-    //Give the current free block to client
-    void* allocatedPtr = FreeList_;
-    FreeList_ = FreeList_->Next;
+    void* allocatedPtr = nullptr;
+    if (Config_.SlabPages_)
+    {
+        //the fullest page with room gives up a block
+        allocatedPtr = PopSlabBlock();
+    }
+    else
+    {
+        //Give the current free block to client
+        allocatedPtr = FreeList_;
+        FreeList_ = FreeList_->Next;
+
+        //mark the block as owned by the client
+        PageInfo* page = FindPage(allocatedPtr);
+        size_t index = 0;
+        if (page && BlockIndex(page, allocatedPtr, index))
+        {
+            SetBlockInUse(page, index, true);
+        }
+    }
     // //Set object blocks to free
     memset(allocatedPtr, ALLOCATED_PATTERN, Stats_.ObjectSize_);
 
@@ -196,25 +295,348 @@ void* ObjectAllocator::Allocate(const char* label)
     return allocatedPtr;
 }
 
+/**
+ * @brief Allocates several blocks at once.
+ * The pages needed are worked out before anything is taken. The blocks already free
+ * are cut off the free list first, then a page is created each time the list runs out
+ * and its blocks are cut off in turn, so the blocks come out in the order Count calls
+ * to Allocate would have returned them. The in-use bits are set a page at a time and
+ * the statistics are updated once.
+ * @param Count Number of blocks wanted.
+ * @param Objects Receives the blocks (room for Count pointers).
+ * @throw OAException Throws an exception if the page limit would be exceeded or the
+ *        system is out of memory. No block is handed out in that case (pages created
+ *        before the system ran out are kept, with all their blocks free).
+ */
+void ObjectAllocator::AllocateBatch(unsigned Count, void* Objects[])
+{
+    if (Config_.UseCPPMemManager_)
+    {
+        unsigned allocated = 0;
+        try
+        {
+            for (; allocated < Count; ++allocated)
+            {
+                Objects[allocated] = Allocate();
+            }
+        }
+        catch (OAException&)
+        {
+            FreeBatch(Objects, allocated);
+            throw;
+        }
+        return;
+    }
+
+    if (Config_.SlabPages_)
+    {
+        //make sure the whole batch fits before anything is taken; the fullest
+        //pages give up their blocks first, so the new (empty) ones come last
+        for (unsigned i = PagesNeeded(Count, "AllocateBatch"); i > 0; --i)
+        {
+            AllocateNewPage();
+        }
+
+        //each block comes from whichever page is the fullest at that point
+        for (unsigned i = 0; i < Count; ++i)
+        {
+            Objects[i] = PopSlabBlock();
+            memset(Objects[i], ALLOCATED_PATTERN, Stats_.ObjectSize_);
+        }
+    }
+    else
+    {
+        //make sure the whole batch fits before anything is taken
+        PagesNeeded(Count, "AllocateBatch");
+
+        //the blocks already free come first, as Allocate would hand them out
+        unsigned taken = 0;
+        GenericObject* block = FreeList_;
+        for (; taken < Count && block; ++taken)
+        {
+            Objects[taken] = block;
+            block = block->Next;
+        }
+        FreeList_ = block;
+
+        //then a page each time the list runs out, its blocks in list order
+        try
+        {
+            while (taken < Count)
+            {
+                AllocateNewPage();
+                for (block = FreeList_; taken < Count && block; ++taken)
+                {
+                    Objects[taken] = block;
+                    block = block->Next;
+                }
+                FreeList_ = block;
+            }
+        }
+        catch (OAException&)
+        {
+            //out of system memory: the list is empty, put the blocks back in order
+            for (unsigned i = taken; i > 0; --i)
+            {
+                GenericObject* returned = static_cast<GenericObject*>(Objects[i - 1]);
+                returned->Next = FreeList_;
+                FreeList_ = returned;
+            }
+            throw;
+        }
+
+        //the blocks of a page are next to each other in Objects, so each run is marked at once
+        for (unsigned first = 0; first < Count;)
+        {
+            PageInfo* page = FindPage(Objects[first]);
+            unsigned last = first + 1;
+            while (last < Count && page && Objects[last] >= static_cast<void*>(page->Page) &&
+                   Objects[last] < static_cast<void*>(page->Page + page->Size))
+            {
+                ++last;
+            }
+            if (page)
+            {
+                MarkBlocksInUse(page, Objects + first, last - first);
+            }
+            for (; first < last; ++first)
+            {
+                memset(Objects[first], ALLOCATED_PATTERN, Stats_.ObjectSize_);
+            }
+        }
+    }
+
+    Stats_.ObjectsInUse_ += Count;
+    Stats_.FreeObjects_ -= Count;
+    if (Stats_.ObjectsInUse_ > Stats_.MostObjects_)
+    {
+        Stats_.MostObjects_ = Stats_.ObjectsInUse_;
+    }
+
+    //each header records its own allocation number
+    if (Config_.HBlockInfo_.type_ == OAConfig::hbNone)
+    {
+        Stats_.Allocations_ += Count;
+        return;
+    }
+    for (unsigned i = 0; i < Count; ++i)
+    {
+        ++Stats_.Allocations_;
+        BlockHeaderCheck(Objects[i], nullptr);
+    }
+}
+
+/**
+ * @brief Creates enough pages for a number of objects ahead of time.
+ * The pages are created (and their patterns written) now, so the memory is faulted in
+ * before the first requests instead of by them. Objects already free count towards
+ * the reservation; the pages needed are worked out before any is created.
+ * @param Objects The number of objects that must be allocatable without a new page.
+ * @throw OAException Throws an exception if MaxPages_ would be exceeded (nothing is
+ *        created then) or if the system is out of memory.
+ */
+void ObjectAllocator::Reserve(unsigned Objects)
+{
+    if (Config_.UseCPPMemManager_ || Objects <= Stats_.FreeObjects_)
+    {
+        return;
+    }
+
+    unsigned pagesNeeded = PagesNeeded(Objects, "Reserve");
+    for (unsigned i = 0; i < pagesNeeded; ++i)
+    {
+        AllocateNewPage();
+    }
+}
+
+/**
+ * @brief Works out how many pages must be created before a number of objects can be
+ * allocated, counting the objects already free.
+ * @param Objects The number of objects wanted.
+ * @param caller Name of the public function asking, for the exception's message.
+ * @return unsigned The number of pages to create (0 if enough objects are free).
+ * @throw OAException Throws an exception if MaxPages_ would be exceeded.
+ */
+unsigned ObjectAllocator::PagesNeeded(unsigned Objects, const char* caller) const
+{
+    if (Objects <= Stats_.FreeObjects_)
+    {
+        return 0;
+    }
+
+    unsigned missing = Objects - Stats_.FreeObjects_;
+    unsigned pagesNeeded = 0;
+    while (missing > 0)
+    {
+        unsigned blocks = PageBlocks(Stats_.PagesInUse_ + pagesNeeded);
+        if (blocks == 0)
+        {
+            pagesNeeded = 0;
+            break;
+        }
+        ++pagesNeeded;
+        missing -= blocks < missing ? blocks : missing;
+    }
+    if (pagesNeeded == 0 || (Config_.MaxPages_ > 0 && Stats_.PagesInUse_ + pagesNeeded > Config_.MaxPages_))
+    {
+        throw OAException(OAException::E_NO_PAGES, std::string(caller) + ":  You have reached maximum pages limit.");
+    }
+    return pagesNeeded;
+}
+
+/**
+ * @brief Frees several blocks at once.
+ * The blocks are sorted by address, so blocks of one page are checked and written
+ * together and a block passed twice ends up next to its duplicate. Every block is
+ * validated before any is freed; they then go onto the free list as one chain,
+ * lowest address first, and the statistics are updated once. With SlabPages_ each
+ * block goes onto its own page's list instead, again lowest address first.
+ * @param Objects The blocks to free.
+ * @param Count Number of entries in Objects.
+ * @throw OAException Throws an exception if any block has already been freed, is not
+ *        on a block boundary, or is corrupted. No block is freed in that case.
+ */
+void ObjectAllocator::FreeBatch(void* const Objects[], unsigned Count)
+{
+    if (Config_.UseCPPMemManager_)
+    {
+        for (unsigned i = 0; i < Count; ++i)
+        {
+            Free(Objects[i]);
+        }
+        return;
+    }
+
+    //the scratch vectors are members, so a steady stream of batches doesn't allocate
+    std::vector<GenericObject*>& blocks = BatchBlocks_;
+    std::vector<PageInfo*>& pages = BatchPages_;
+    std::vector<size_t>& indices = BatchIndices_;
+    blocks.clear();
+    for (unsigned i = 0; i < Count; ++i)
+    {
+        if (Objects[i])
+        {
+            blocks.push_back(static_cast<GenericObject*>(Objects[i]));
+        }
+    }
+    if (blocks.empty())
+    {
+        return;
+    }
+    std::sort(blocks.begin(), blocks.end(), std::less<GenericObject*>());
+
+    //validate everything first, same checks and order as Free
+    indices.assign(blocks.size(), 0);
+    pages.assign(blocks.size(), nullptr);
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        pages[i] = FindPage(blocks[i]);
+        bool onBlock = pages[i] && BlockIndex(pages[i], blocks[i], indices[i]);
+
+        if (onBlock && (!IsBlockInUse(pages[i], indices[i]) || (i > 0 && blocks[i] == blocks[i - 1])))
+        {
+            throw OAException(OAException::E_MULTIPLE_FREE, "FreeBatch: Object has already been freed.");
+        }
+        if (!onBlock)
+        {
+            throw OAException(OAException::E_BAD_BOUNDARY, "Boundary: Object has bad boundary.");
+        }
+        if (CorruptedCheck(blocks[i]))
+        {
+            throw OAException(OAException::E_CORRUPTED_BLOCK, "Corrupted: Object has corruption.");
+        }
+    }
+
+    //build the chain back to front so the lowest address is handed out first
+    GenericObject* chain = FreeList_;
+    for (size_t i = blocks.size(); i-- > 0;)
+    {
+        memset(blocks[i], FREED_PATTERN, Stats_.ObjectSize_);
+        if (Config_.SlabPages_)
+        {
+            blocks[i]->Next = pages[i]->FreeList;
+            pages[i]->FreeList = blocks[i];
+        }
+        else
+        {
+            blocks[i]->Next = chain;
+            chain = blocks[i];
+        }
+        SetBlockInUse(pages[i], indices[i], false);
+        BlockHeaderCheckFree(blocks[i]);
+    }
+    FreeList_ = chain;
+
+    unsigned freed = static_cast<unsigned>(blocks.size());
+    Stats_.Deallocations_ += freed;
+    Stats_.FreeObjects_ += freed;
+    Stats_.ObjectsInUse_ -= freed;
+}
+
 /**
  * @brief Allocates a new page of blocks and adds them to the free list.
  * This function is called when there are no free blocks available for allocation.
- * It allocates a new page, initializes it, and links the blocks within the page
- * into the allocator's free list. It updates the allocator's statistics accordingly.
+ * It creates a new page and links the page's chain of blocks into the allocator's
+ * free list. It updates the allocator's statistics accordingly. With SlabPages_
+ * the chain becomes the page's own free list and the page goes into the empty bin.
  * @throw OAException Throws an exception if a new page cannot be allocated due
  *        to system memory constraints.
  */
 void ObjectAllocator::AllocateNewPage()
+{
+    GenericObject* tail = nullptr;
+    GenericObject* head = CreatePage(tail);
+
+    if (Config_.SlabPages_)
+    {
+        // CreatePage registered the page at the back
+        PageInfo* info = Pages_.back();
+        info->FreeList = head;
+        BinPage(info);
+    }
+    // The whole chain goes in front of the current free list
+    else if (tail)
+    {
+        tail->Next = FreeList_;
+        FreeList_ = head;
+    }
+
+    // Update the number of free objects (CreatePage registered the page at the back)
+    Stats_.FreeObjects_ += Pages_.back()->Blocks;
+}
+
+/**
+ * @brief Allocates and initializes a page, without touching the free list.
+ * The page is filled with its patterns, linked into the page list and registered
+ * for page lookups. Its blocks come back as one chain, in the order they would
+ * have been pushed onto the free list, so the caller can publish it in one step.
+ * With Colors_ the blocks of successive pages start ColorStep_ further in, wrapping
+ * after Colors_ pages, so block N of different pages falls in different cache sets.
+ * With MaxObjectsPerPage_ the page holds as many blocks as PageBlocks gives for the
+ * pages already in use.
+ * @param tail Receives the last block of the chain (whose Next is nullptr).
+ * @return GenericObject* The first block of the chain.
+ * @throw OAException Throws an exception if a new page cannot be allocated due
+ *        to system memory constraints.
+ */
+GenericObject* ObjectAllocator::CreatePage(GenericObject*& tail)
 {
     //// Allocate a new page
     char* newPage = nullptr;
+    PageInfo* info = nullptr;
+
+    size_t color = Config_.Colors_ > 1 ? (NextColor_ % Config_.Colors_) * ColorStep_ : 0;
+    unsigned blocks = PageBlocks(Stats_.PagesInUse_);
+    size_t size = Stats_.PageSize_ + (blocks - Config_.ObjectsPerPage_) * BlockStride_;
 
     try
     {
-        newPage = new char[Stats_.PageSize_] {};
+        newPage = AllocatePageMemory(size);
+        info = new PageInfo(newPage, FirstBlockOffset_ + color, blocks, size);
     }
     catch (const std::bad_alloc&)
     {
+        FreePageMemory(newPage);
         throw OAException(OAException::E_NO_MEMORY, "allocate_new_page: No system memory available");
 
     }
@@ -222,8 +644,16 @@ void ObjectAllocator::AllocateNewPage()
     // Initialize the new page by setting up the free list within the page
     char* currentBlock = newPage;
 
-    // Skip the space for the page list link pointer
-    currentBlock += sizeof(GenericObject*);
+    // Skip the space for the page list link pointer and the client's page header (left zeroed)
+    currentBlock += sizeof(GenericObject*) + Config_.PageHeaderSize_;
+
+    // Shift the blocks by the page's color
+    if (color > 0)
+    {
+        memset(currentBlock, ALIGN_PATTERN, color);
+        currentBlock += color;
+    }
+    ++NextColor_;
 
     // Apply left alignment pattern if necessary
     if (Config_.LeftAlignSize_ > 0)
@@ -232,55 +662,77 @@ void ObjectAllocator::AllocateNewPage()
         currentBlock += Config_.LeftAlignSize_;
     }
 
-    // Construct the free list for the new page
-    for (size_t i = 0; i < Config_.ObjectsPerPage_; ++i)
+    // Construct the chain of blocks for the new page
+    GenericObject* chain = nullptr;
+    tail = nullptr;
+    // The header of each block is left zeroed
+    currentBlock += Config_.HBlockInfo_.size_ + Config_.PadBytes_;
+    for (size_t i = 0; i < blocks; ++i, currentBlock += BlockStride_)
     {
-        // Apply header info and padding before the object
-        if (Config_.HBlockInfo_.size_ > 0)
-        {
-            //  memset(currentBlock, PAD_PATTERN, Config_.HBlockInfo_.size_);
-            currentBlock += Config_.HBlockInfo_.size_;
-        }
-
-        if (Config_.PadBytes_ > 0)
-        {
-            memset(currentBlock, PAD_PATTERN, Config_.PadBytes_);
-            currentBlock += Config_.PadBytes_;
-        }
+        // Pads, unallocated pattern and (but after the last object) inter-object alignment
+        FormatBlock(currentBlock, Stats_.ObjectSize_, Config_.PadBytes_, i < blocks - 1 ? Config_.InterAlignSize_ : 0);
 
-        // Mark the object area with the unallocated pattern
-        memset(currentBlock, UNALLOCATED_PATTERN, Stats_.ObjectSize_);
-
-        // Link this block into the free list
+        // Link this block into the chain
         GenericObject* newObject = reinterpret_cast<GenericObject*>(currentBlock);
-        newObject->Next = FreeList_;
-        FreeList_ = newObject;
-        currentBlock += Stats_.ObjectSize_;
-
-        // Apply padding after the object
-        if (Config_.PadBytes_ > 0)
+        newObject->Next = chain;
+        chain = newObject;
+        if (!tail)
         {
-            memset(currentBlock, PAD_PATTERN, Config_.PadBytes_);
-            currentBlock += Config_.PadBytes_;
+            tail = newObject;
         }
-
-        // Apply inter-object alignment pattern if necessary and not the last object
-        if (Config_.InterAlignSize_ > 0 && i < Config_.ObjectsPerPage_ - 1)
-        {
-            memset(currentBlock, ALIGN_PATTERN, Config_.InterAlignSize_);
-            currentBlock += Config_.InterAlignSize_;
-        }
-
-        // Update the number of free objects
-        ++Stats_.FreeObjects_;
     }
 
     // Link the new page into the page list
     GenericObject* pageHeader = reinterpret_cast<GenericObject*>(newPage);
     pageHeader->Next = PageList_;
     PageList_ = pageHeader;
+    RegisterPage(info);
     ++Stats_.PagesInUse_;
+    TotalBlocks_ += blocks;
+    ++Occupancy_[0];
+    EmptyBlocks_ += blocks;
+    ++PagesCreated_;
+
+    return chain;
+}
+
+/**
+ * @brief Writes the patterns of a new block: PAD_PATTERN on both sides of the object,
+ * UNALLOCATED_PATTERN over it and ALIGN_PATTERN over the alignment bytes after it.
+ * Shared with BasicObjectAllocator, so both make the same pages.
+ * @param Object The object (its left pad starts PadBytes before it).
+ * @param ObjectSize The size of the object.
+ * @param PadBytes The number of pad bytes on each side.
+ * @param InterAlignSize The alignment bytes after the right pad (0 for the last block).
+ */
+void ObjectAllocator::FormatBlock(void* Object, size_t ObjectSize, size_t PadBytes, size_t InterAlignSize)
+{
+    char* object = static_cast<char*>(Object);
+    memset(object - PadBytes, PAD_PATTERN, PadBytes);
+    memset(object, UNALLOCATED_PATTERN, ObjectSize);
+    memset(object + ObjectSize, PAD_PATTERN, PadBytes);
+    memset(object + ObjectSize + PadBytes, ALIGN_PATTERN, InterAlignSize);
+}
+
+/**
+ * @brief Hands the whole free list to the caller.
+ * Used by front ends that keep the free blocks themselves (e.g. the lock-free
+ * allocator takes the first page's blocks this way). The blocks are no longer
+ * counted as free objects of this allocator. With SlabPages_ the free blocks
+ * belong to their pages and nothing is handed over.
+ * @return GenericObject* The former head of the free list.
+ */
+GenericObject* ObjectAllocator::TakeFreeList()
+{
+    if (Config_.SlabPages_)
+    {
+        return nullptr;
+    }
 
+    GenericObject* list = FreeList_;
+    FreeList_ = nullptr;
+    Stats_.FreeObjects_ = 0;
+    return list;
 }
 
 /**
@@ -291,7 +743,7 @@ void ObjectAllocator::AllocateNewPage()
  * @param allocatedBlock Pointer to the allocated block whose header is to be updated.
  * @param label Optional debug label for the block.
  */
-void ObjectAllocator::BlockHeaderCheck(void* allocatedBlock, const char* label) const
+void ObjectAllocator::BlockHeaderCheck(void* allocatedBlock, const char* label)
 {
     if (Config_.HBlockInfo_.type_ == Config_.hbNone)
     {
@@ -302,26 +754,9 @@ void ObjectAllocator::BlockHeaderCheck(void* allocatedBlock, const char* label)
     switch (Config_.HBlockInfo_.type_)
     {
     case OAConfig::HBLOCK_TYPE::hbBasic:
-    {
-        unsigned* allocation = reinterpret_cast<unsigned*>(headerBlock);
-        *allocation = Stats_.Allocations_;
-        *(headerBlock += sizeof(unsigned)) = true;
-        break;
-    }
     case OAConfig::HBLOCK_TYPE::hbExtended:
     {
-        headerBlock += Config_.HBlockInfo_.additional_;
-        short* useCount = reinterpret_cast<short*>(headerBlock);
-        ++(*useCount);
-        headerBlock += sizeof(short);
-
-        // Set alloc number
-        unsigned* allocation = reinterpret_cast<unsigned*>(headerBlock);
-        *allocation = Stats_.Allocations_;
-        *(headerBlock += sizeof(unsigned)) = true; 
-
-        // Set flag
-        //*headerBlock = 1;
+        WriteHeader(allocatedBlock, Config_.HBlockInfo_, Config_.PadBytes_, Stats_.Allocations_, true);
         break;
     }
     case OAConfig::HBLOCK_TYPE::hbExternal:
@@ -330,13 +765,10 @@ void ObjectAllocator::BlockHeaderCheck(void* allocatedBlock, const char* label)
         MemBlockInfo** externalHeader = reinterpret_cast<MemBlockInfo**>(headerBlock);
         try
         {
-            // Allocate external header block
-            (*externalHeader) = new MemBlockInfo{};
-
-            // Allocate memory for label
-            if (label) {
-                (*externalHeader)->label = new char[std::strlen(label) + 1] {};
-            }
+            // Take an external header block and share the label's one copy
+            MemBlockInfo* info = NewExternalHeader();
+            info->label = InternLabel(label);
+            (*externalHeader) = info;
         }
         catch (std::bad_alloc&)
         {
@@ -346,10 +778,6 @@ void ObjectAllocator::BlockHeaderCheck(void* allocatedBlock, const char* label)
         // Assign external header members
         (*externalHeader)->in_use = true;
         (*externalHeader)->alloc_num = Stats_.Allocations_;
-        if (label) 
-        {
-            std::strcpy((*externalHeader)->label, label);
-        }
         break;
     }
     case OAConfig::HBLOCK_TYPE::hbNone:
@@ -368,7 +796,7 @@ void ObjectAllocator::BlockHeaderCheck(void* allocatedBlock, const char* label)
  * and external information as necessary.
  * @param allocatedBlock Pointer to the block being deallocated.
  */
-void ObjectAllocator::BlockHeaderCheckFree(void* allocatedBlock) const
+void ObjectAllocator::BlockHeaderCheckFree(void* allocatedBlock)
 {
     if (Config_.HBlockInfo_.type_ == Config_.hbNone)
     {
@@ -379,26 +807,9 @@ void ObjectAllocator::BlockHeaderCheckFree(void* allocatedBlock) const
     switch (Config_.HBlockInfo_.type_)
     {
     case OAConfig::HBLOCK_TYPE::hbBasic:
-    {
-       
-        // Update alloc num
-        unsigned* allocation = reinterpret_cast<unsigned*>(headerBlock);
-        *allocation = 0;
-        *(headerBlock += sizeof(unsigned)) = false;
-
-    
-        break;
-    }
     case OAConfig::HBLOCK_TYPE::hbExtended:
     {
-        headerBlock += Config_.HBlockInfo_.additional_;
-        headerBlock += sizeof(short);
-
-        // Set alloc number
-        unsigned* allocation = reinterpret_cast<unsigned*>(headerBlock);
-        *allocation = 0;
-        *(headerBlock += sizeof(unsigned)) = false;
-
+        WriteHeader(allocatedBlock, Config_.HBlockInfo_, Config_.PadBytes_, 0, false);
         break;
     }
     case OAConfig::HBLOCK_TYPE::hbExternal:
@@ -406,17 +817,12 @@ void ObjectAllocator::BlockHeaderCheckFree(void* allocatedBlock) const
         
         MemBlockInfo** externalHeader = reinterpret_cast<MemBlockInfo**>(headerBlock);
 
-        // Allocate external header block
-        (*externalHeader) = new MemBlockInfo{};
-
-        // Allocate memory for label
-        if ((*externalHeader) && (*externalHeader)->label)
-        {
-            delete[](*externalHeader)->label;
-        }
-        if ((externalHeader))
+        // Return the external header block; its label stays interned
+        if (*externalHeader)
         {
-            delete (*externalHeader);
+            GenericObject* record = reinterpret_cast<GenericObject*>(*externalHeader);
+            record->Next = FreeHeaders_;
+            FreeHeaders_ = record;
             (*externalHeader) = nullptr;
         }
         break;
@@ -431,19 +837,107 @@ void ObjectAllocator::BlockHeaderCheckFree(void* allocatedBlock) const
 }
 
 /**
- * @brief Frees a previously allocated object and updates allocator statistics.
- * This function releases an object back to the allocator's free list, allowing it to be reused.
- * It performs several checks to ensure the object can be safely freed, including whether the
- * object is already freed, if it's within the allocator's managed memory boundaries, and if the
- * object's memory is corrupted. It updates the allocator's statistics upon successful deallocation.
- * @param Object Pointer to the object to be freed.
- * @throw OAException Throws an exception if the object has already been freed, is not within the
- *        allocator's boundaries, or its memory is corrupted.
+ * @brief Writes the basic or extended header of a block.
+ * Allocating sets the allocation number and the in-use flag, and counts the use in
+ * an extended header; freeing clears the number and the flag. Shared with
+ * BasicObjectAllocator, so both leave the same bytes.
+ * @param Object The object (its header ends PadBytes before it).
+ * @param Header The header type (hbBasic or hbExtended) and its additional bytes.
+ * @param PadBytes The number of pad bytes between the header and the object.
+ * @param AllocationNumber The allocation number to record when allocating.
+ * @param Allocated True when the block is handed to the client, false when it is returned.
  */
-void ObjectAllocator::Free(void* Object)
+void ObjectAllocator::WriteHeader(void* Object, const OAConfig::HeaderBlockInfo& Header, size_t PadBytes,
+                                  unsigned AllocationNumber, bool Allocated)
 {
-    //return if pointer is empty
-    if (!Object)
+    char* headerBlock = static_cast<char*>(Object) - PadBytes - Header.size_;
+    if (Header.type_ == OAConfig::hbExtended)
+    {
+        headerBlock += Header.additional_;
+        if (Allocated)
+        {
+            unsigned short useCount;
+            memcpy(&useCount, headerBlock, sizeof(useCount));
+            ++useCount;
+            memcpy(headerBlock, &useCount, sizeof(useCount));
+        }
+        headerBlock += sizeof(unsigned short);
+    }
+
+    unsigned allocation = Allocated ? AllocationNumber : 0;
+    memcpy(headerBlock, &allocation, sizeof(allocation));
+    headerBlock[sizeof(unsigned)] = Allocated;
+}
+
+/**
+ * @brief Takes a MemBlockInfo record from the allocator's own pool.
+ * Records live on pages of HeaderPool_ and are recycled through FreeHeaders_, so an
+ * external header costs a pointer pop instead of a call to new.
+ * @return MemBlockInfo* A cleared record.
+ * @throw std::bad_alloc If the pool can't grow.
+ */
+MemBlockInfo* ObjectAllocator::NewExternalHeader()
+{
+    if (!FreeHeaders_)
+    {
+        GenericObject* tail = nullptr;
+        try
+        {
+            FreeHeaders_ = HeaderPool_->CreatePage(tail);
+        }
+        catch (const OAException&)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    MemBlockInfo* info = reinterpret_cast<MemBlockInfo*>(FreeHeaders_);
+    FreeHeaders_ = FreeHeaders_->Next;
+    *info = MemBlockInfo{};
+    return info;
+}
+
+/**
+ * @brief Gets the allocator's one copy of a label.
+ * Every distinct label is stored once in Labels_ and kept until the allocator is
+ * destroyed. Blocks are usually labelled by call site, so the label of the last
+ * call is checked first and a repeat costs a string compare, not a hash.
+ * @param label The client's label, may be nullptr.
+ * @return char* The interned copy, or nullptr without a label.
+ * @throw std::bad_alloc If a new label can't be stored.
+ */
+char* ObjectAllocator::InternLabel(const char* label)
+{
+    if (!label)
+    {
+        return nullptr;
+    }
+    if (LastLabel_ == label && std::strcmp(LastInterned_, label) == 0)
+    {
+        return LastInterned_;
+    }
+
+    //the set's nodes never move, so the string's characters stay put
+    const std::string& interned = *Labels_.insert(label).first;
+    LastLabel_ = label;
+    LastInterned_ = const_cast<char*>(interned.c_str());
+    return LastInterned_;
+}
+
+/**
+ * @brief Frees a previously allocated object and updates allocator statistics.
+ * This function releases an object back to the allocator's free list, allowing it to be reused.
+ * It performs several checks to ensure the object can be safely freed, including whether the
+ * object is already freed, if it's within the allocator's managed memory boundaries, and if the
+ * object's memory is corrupted. It updates the allocator's statistics upon successful deallocation.
+ * @param Object Pointer to the object to be freed.
+ * @throw OAException Throws an exception if the object has already been freed, is not within the
+ *        allocator's boundaries, or its memory is corrupted.
+ */
+void ObjectAllocator::Free(void* Object)
+{
+    //return if pointer is empty
+    if (!Object)
     {
         return;
     }
@@ -461,13 +955,18 @@ void ObjectAllocator::Free(void* Object)
         return;
     }
 
+    //find the owning page once, every check below works off it
+    PageInfo* page = FindPage(Object);
+    size_t index = 0;
+    bool onBlock = page && BlockIndex(page, Object, index);
+
     //check for free
-    if (CheckErrorFree(reinterpret_cast<GenericObject*>(Object)))
+    if (onBlock && !IsBlockInUse(page, index))
     {
         throw OAException(OAException::E_MULTIPLE_FREE, "Free: Object has already been freed.");
     }
     //check the block boundary
-    if (CheckBlockBoundary(Object))
+    if (!onBlock)
     {
         throw OAException(OAException::E_BAD_BOUNDARY, "Boundary: Object has bad boundary.");
     }
@@ -481,10 +980,12 @@ void ObjectAllocator::Free(void* Object)
     //set object blocks to free
     memset(Object, FREED_PATTERN, Stats_.ObjectSize_);
 
-    //add the object back to the free list
+    //add the object back to the free list (its page's own list with SlabPages_)
     GenericObject* addBlock = reinterpret_cast<GenericObject*>(Object);
-    addBlock->Next = FreeList_;
-    FreeList_ = addBlock;
+    GenericObject*& freeList = Config_.SlabPages_ ? page->FreeList : FreeList_;
+    addBlock->Next = freeList;
+    freeList = addBlock;
+    SetBlockInUse(page, index, false);
 
     //update allocator statistics
     ++Stats_.Deallocations_;
@@ -497,28 +998,21 @@ void ObjectAllocator::Free(void* Object)
 
 /**
  * @brief Checks if the specified block has already been freed.
- * Iterates through the free list to determine if the block is already present,
- * indicating it has been previously freed. This helps in detecting double free errors.
+ * Looks the block up in its page's in-use bitmap, so a double free is detected
+ * without walking the free list.
  * @param block Pointer to the block to check.
- * @return bool True if the block is found in the free list, indicating it's already been freed; false otherwise.
+ * @return bool True if the block is on a page and currently free, indicating it's already been freed; false otherwise.
  */
 bool ObjectAllocator::CheckErrorFree(GenericObject* block) const
 {
-    for (GenericObject* current = FreeList_; current != nullptr; current = current->Next)
-    {
-        if (current == block)
-        {   //found the block in the free list
-            return true;
-        }
-    }
-    //block not found in the free list
-    return false;
+    return IsBlockFree(block);
 }
 
 /**
  * @brief Checks for memory corruption around a block's boundaries.
  * Verifies the integrity of padding bytes around the allocated block to detect memory corruption.
  * This function is part of the allocator's debugging and validation mechanisms to ensure memory safety.
+ * The pads are compared with PatternScan, a whole vector at a time on CPUs that have them.
  * @param block Pointer to the block to check for corruption.
  * @return bool True if corruption is detected in the padding bytes; false if the padding is intact.
  */
@@ -528,72 +1022,540 @@ bool ObjectAllocator::CorruptedCheck(GenericObject* block) const
     {
         return false;
     }
+    return PadsCorrupted(block, Stats_.ObjectSize_, Config_.PadBytes_);
+}
+
+/**
+ * @brief Checks the pad bytes on both sides of an object.
+ * Each pad is compared with PatternScan, a whole vector at a time on CPUs that have them.
+ * Shared with BasicObjectAllocator, so both report the same blocks.
+ * @param Object The object (its pads are PadBytes before it and right after it).
+ * @param ObjectSize The size of the object.
+ * @param PadBytes The number of pad bytes on each side.
+ * @return bool True if a pad byte no longer holds PAD_PATTERN.
+ */
+bool ObjectAllocator::PadsCorrupted(const void* Object, size_t ObjectSize, size_t PadBytes)
+{
+    const unsigned char* leftPadding = static_cast<const unsigned char*>(Object) - PadBytes;
+    const unsigned char* rightPadding = static_cast<const unsigned char*>(Object) + ObjectSize;
+    return !PatternScan::Matches(leftPadding, PadBytes, PAD_PATTERN) ||
+           !PatternScan::Matches(rightPadding, PadBytes, PAD_PATTERN);
+}
 
-    //convert
-    unsigned char* blockStart = reinterpret_cast<unsigned char*>(block);
+/**
+ * @brief Checks if the given block starts on a block boundary of one of the allocator's pages.
+ * The owning page is found with FindPage (constant time for aligned pages, a binary search
+ * otherwise) and the offset into the page must then land exactly on a block.
+ * @param block Pointer to the block whose boundary is to be checked.
+ * @return bool Returns true if the block is not on any page, or is on a page but not on a
+ * block boundary, indicating a potential error; otherwise, false.
+ */
+bool ObjectAllocator::CheckBlockBoundary(void* block)
+{
+    const PageInfo* page = FindPage(block);
+    size_t index = 0;
+    return !page || !BlockIndex(page, block, index);
+}
 
-    //calculate padding
-    unsigned char* leftPadding = blockStart - Config_.PadBytes_;
-    unsigned char* rightPadding = blockStart + Stats_.ObjectSize_;
+/**
+ * @brief Finds the page that contains an address.
+ * The page used by the previous lookup is tried first, since consecutive allocations
+ * and frees tend to stay on one page. Pages of an arena are found from the address's
+ * offset into it, aligned pages by masking the address down to the page base; otherwise
+ * the sorted page index is binary searched.
+ * @param address Any address that may lie on one of the allocator's pages.
+ * @return PageInfo* The bookkeeping of the owning page, or nullptr if no page holds the address.
+ */
+PageInfo* ObjectAllocator::FindPage(const void* address) const
+{
+    const char* addressPtr = static_cast<const char*>(address);
 
-    //check if any byte in the left padding
-    for (size_t i = 0; i < Config_.PadBytes_; ++i)
+    if (LastPage_ && addressPtr >= LastPage_->Page && addressPtr < LastPage_->Page + LastPage_->Size)
     {
-        //check left padding 
-        if (leftPadding[i] != PAD_PATTERN)
+        return LastPage_;
+    }
+
+    PageInfo* page = nullptr;
+    if (ArenaBase_)
+    {
+        //one range check, then the slot holds the page
+        if (addressPtr < ArenaBase_ || addressPtr >= ArenaBase_ + ArenaPages_.size() * PageFootprint_)
+        {
+            return nullptr;
+        }
+        page = ArenaPages_[static_cast<size_t>(addressPtr - ArenaBase_) / PageFootprint_];
+    }
+    else if (Config_.AlignPages_)
+    {
+        const char* base = reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(addressPtr) & ~(static_cast<uintptr_t>(PageFootprint_) - 1));
+        auto found = PageMap_.find(base);
+        if (found != PageMap_.end())
         {
-            return true;
+            page = found->second;
         }
     }
+    else
+    {
+        page = PageInfo::Find(PageIndex_, addressPtr);
+    }
+
+    if (!page || addressPtr >= page->Page + page->Size)
+    {
+        return nullptr;
+    }
+
+    LastPage_ = page;
+    return page;
+}
+
+/**
+ * @brief Gets the raw memory for one page, zero-filled.
+ * Aligned pages are placed on a PageFootprint_ boundary so their base can be found
+ * from any block address with a mask. OS pages come from the page provider, already
+ * zero-filled and aligned on their footprint. Arena pages take the lowest unused slot.
+ * @param size The bytes the page needs (at most PageFootprint_ for aligned and OS pages).
+ * @return char* The page memory.
+ * @throw std::bad_alloc If the system is out of memory.
+ */
+char* ObjectAllocator::AllocatePageMemory(size_t size)
+{
+    if (PageProvider_)
+    {
+        return PageProvider_->Allocate();
+    }
 
-    //check if any byte in the right padding
-    for (size_t i = 0; i < Config_.PadBytes_; ++i)
+    if (ArenaBase_)
     {
-        //check right padding
-        if (rightPadding[i] != PAD_PATTERN)
+        if (ArenaFree_.empty())
         {
-            //corrupted
-            return true;
+            throw std::bad_alloc();
         }
+        char* page = ArenaBase_ + ArenaFree_.back() * PageFootprint_;
+        ArenaFree_.pop_back();
+        std::memset(page, 0, size);
+        return page;
+    }
+
+    if (!Config_.AlignPages_)
+    {
+        return new char[size] {};
     }
 
-    //if none return false
-    return false;
+    void* memory = nullptr;
+#ifdef _MSC_VER
+    memory = _aligned_malloc(PageFootprint_, PageFootprint_);
+#else
+    if (posix_memalign(&memory, PageFootprint_, PageFootprint_) != 0)
+    {
+        memory = nullptr;
+    }
+#endif
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    std::memset(memory, 0, size);
+    return static_cast<char*>(memory);
 }
 
 /**
- * @brief Checks if the given block is within the boundary of any allocated pages.
- * This function iterates through all pages managed by the ObjectAllocator to determine
- * if the provided block address falls within the boundaries of these pages. It's used
- * to verify that a block being freed or used is actually part of the allocator's memory
- * pool, helping to prevent errors related to invalid memory access.
- * @param block Pointer to the block whose boundary is to be checked.
- * @return bool Returns true if the block is not within the boundary of any allocated page,
- * indicating a potential error; otherwise, false.
+ * @brief Gets the number of blocks for a new page.
+ * Without MaxObjectsPerPage_ every page holds ObjectsPerPage_ blocks. With it each
+ * page holds twice as many as the one before, up to MaxObjectsPerPage_, so a burst
+ * of N objects takes a number of pages logarithmic in N. Counting from the pages in
+ * use lets the pages shrink again after FreeEmptyPages.
+ * @param pages The number of pages already in use.
+ * @return unsigned The number of blocks the next page holds.
  */
-bool ObjectAllocator::CheckBlockBoundary(void* block)
+unsigned ObjectAllocator::PageBlocks(unsigned pages) const
+{
+    unsigned blocks = Config_.ObjectsPerPage_;
+    if (Config_.MaxObjectsPerPage_ == 0)
+    {
+        return blocks;
+    }
+
+    for (unsigned i = 0; i < pages && blocks < Config_.MaxObjectsPerPage_; ++i)
+    {
+        blocks = blocks > Config_.MaxObjectsPerPage_ / 2 ? Config_.MaxObjectsPerPage_ : blocks * 2;
+    }
+    return blocks;
+}
+
+/**
+ * @brief Gets the bytes reserved for a page, as told to the page callback.
+ * Pages of one size share PageFootprint_; grown pages reserve exactly their size.
+ * @param page The page.
+ * @return size_t The bytes reserved for it.
+ */
+size_t ObjectAllocator::PageFootprint(const PageInfo* page) const
+{
+    return Config_.MaxObjectsPerPage_ ? page->Size : PageFootprint_;
+}
+
+/**
+ * @brief Returns page memory obtained from AllocatePageMemory.
+ * OS pages go back to the OS, so freeing empty pages shrinks the resident size.
+ * Arena pages only give their slot back to the arena.
+ * @param page The page memory (may be nullptr).
+ */
+void ObjectAllocator::FreePageMemory(char* page)
+{
+    if (PageProvider_)
+    {
+        PageProvider_->Release(page);
+        return;
+    }
+
+    if (ArenaBase_)
+    {
+        //the slot stays in the arena for the next page, lowest first
+        if (page)
+        {
+            unsigned slot = static_cast<unsigned>((page - ArenaBase_) / PageFootprint_);
+            ArenaFree_.insert(std::upper_bound(ArenaFree_.begin(), ArenaFree_.end(), slot, std::greater<unsigned>()), slot);
+        }
+        return;
+    }
+
+    if (!Config_.AlignPages_)
+    {
+        delete[] page;
+        return;
+    }
+
+#ifdef _MSC_VER
+    _aligned_free(page);
+#else
+    std::free(page);
+#endif
+}
+
+/**
+ * @brief Adds a new page's bookkeeping to the page lookups.
+ * @param page The bookkeeping of the page that was just linked into PageList_.
+ */
+void ObjectAllocator::RegisterPage(PageInfo* page)
+{
+    Pages_.push_back(page);
+
+    PageInfo::Insert(PageIndex_, page);
+
+    if (ArenaBase_)
+    {
+        ArenaPages_[static_cast<size_t>(page->Page - ArenaBase_) / PageFootprint_] = page;
+    }
+    else if (Config_.AlignPages_)
+    {
+        PageMap_[page->Page] = page;
+    }
+
+    if (PageCallback_)
+    {
+        PageCallback_(page->Page, PageFootprint(page), true, PageCallbackContext_);
+    }
+}
+
+/**
+ * @brief Removes a page from the constant-time page lookups before the page is released.
+ * The bins, the arena slot or page map, the last page found and the page's handle index
+ * let go of it here. Its entries in Pages_ and PageIndex_ stay until CompactPages, so
+ * releasing many pages costs one pass over those vectors rather than one per page.
+ * @param page The bookkeeping of the page being released; its Page is cleared to mark it.
+ */
+void ObjectAllocator::UnregisterPage(PageInfo* page)
 {
+    if (Config_.SlabPages_)
+    {
+        UnbinPage(page);
+    }
+
+    if (ArenaBase_)
+    {
+        ArenaPages_[static_cast<size_t>(page->Page - ArenaBase_) / PageFootprint_] = nullptr;
+    }
+    else if (Config_.AlignPages_)
+    {
+        PageMap_.erase(page->Page);
+    }
 
-    char* blockCharPtr = static_cast<char*>(block);
+    if (LastPage_ == page)
+    {
+        LastPage_ = nullptr;
+    }
+
+    //the page's handle index (and its generations) waits for another page
+    if (page->HandlePage)
+    {
+        HandlePages_[page->HandlePage - 1].Page = nullptr;
+        FreeHandlePages_.push_back(page->HandlePage - 1);
+    }
 
-    //loop
-    for (GenericObject* currentPage = PageList_; currentPage != nullptr; currentPage = currentPage->Next)
+    if (PageCallback_)
     {
+        PageCallback_(page->Page, PageFootprint(page), false, PageCallbackContext_);
+    }
+
+    page->Page = nullptr;
+}
+
+/**
+ * @brief Drops the pages UnregisterPage marked from Pages_ and PageIndex_ and deletes
+ * their bookkeeping, in one pass over each vector.
+ */
+void ObjectAllocator::CompactPages()
+{
+    auto unregistered = [](const PageInfo* page) { return page->Page == nullptr; };
+    PageIndex_.erase(std::remove_if(PageIndex_.begin(), PageIndex_.end(), unregistered), PageIndex_.end());
 
-        //get the address
-        char* pageStart = reinterpret_cast<char*>(currentPage);
-        char* pageEnd = pageStart + Stats_.PageSize_;
+    //keep ValidateSome's cursor on the same page, or on the one that took the page's place
+    size_t cursor = ValidatePage_;
+    size_t kept = 0;
+    for (size_t i = 0; i < Pages_.size(); ++i)
+    {
+        PageInfo* page = Pages_[i];
+        if (!unregistered(page))
+        {
+            Pages_[kept++] = page;
+            continue;
+        }
 
-        //check if the block within boundaries
-        if (blockCharPtr >= pageStart && blockCharPtr < pageEnd)
+        if (i < cursor)
+        {
+            --ValidatePage_;
+        }
+        else if (i == cursor)
         {
-            //the block is within boundary
-            return false;
+            ValidateBlock_ = 0;
         }
+        delete page;
     }
+    Pages_.resize(kept);
+}
+
+/**
+ * @brief Converts a block address into its index on the page.
+ * @param page The page that holds the block.
+ * @param block Address handed out to (or returned by) the client.
+ * @param index Receives the block index when the address is a block start.
+ * @return bool True if the address is exactly the start of one of the page's blocks.
+ */
+bool ObjectAllocator::BlockIndex(const PageInfo* page, const void* block, size_t& index) const
+{
+    return page->IndexOf(block, BlockStride_, index);
+}
 
-    //the block not within the boundary
-    return true;
+/**
+ * @brief Reads a block's state from the page's in-use bitmap.
+ * @param page The page that holds the block.
+ * @param index Index of the block on the page.
+ * @return bool True if the block is currently owned by the client.
+ */
+bool ObjectAllocator::IsBlockInUse(const PageInfo* page, size_t index) const
+{
+    return page->IsInUse(index);
+}
+
+/**
+ * @brief Updates a block's state in the page's in-use bitmap and live count.
+ * With SlabPages_ the page also moves to the bin of its new live count. The
+ * telemetry counters follow the page to its new occupancy.
+ * @param page The page that holds the block.
+ * @param index Index of the block on the page.
+ * @param inUse True when the block is handed to the client, false when it is returned.
+ */
+void ObjectAllocator::SetBlockInUse(PageInfo* page, size_t index, bool inUse)
+{
+    if (page->IsInUse(index) == inUse)
+    {
+        return;
+    }
+
+    if (Config_.SlabPages_)
+    {
+        UnbinPage(page);
+    }
+
+    page->SetInUse(index, inUse);
+    if (!inUse)
+    {
+        //every handle to the block is stale from now on (generation 0 is skipped)
+        if (page->HandlePage)
+        {
+            unsigned short& generation = HandlePages_[page->HandlePage - 1].Generations[index];
+            generation = static_cast<unsigned short>(generation + 1u < (1u << HandleGenerationBits_) ? generation + 1u : 1u);
+        }
+    }
+    CountOccupancy(page, inUse ? page->Live - 1 : page->Live + 1);
+
+    if (Config_.SlabPages_)
+    {
+        BinPage(page);
+    }
+}
+
+/**
+ * @brief Updates the telemetry counters after a page's live count changed.
+ * This runs on every Allocate and Free, so it only compares the live count with the
+ * range that keeps the page in its bucket. The bucket is worked out again when the
+ * page leaves that range, about 10 times per fill of a page.
+ * @param page The page, its live count already changed.
+ * @param previousLive The page's live count before the change.
+ */
+void ObjectAllocator::CountOccupancy(PageInfo* page, unsigned previousLive)
+{
+    if (page->Live >= page->BucketMin && page->Live <= page->BucketMax)
+    {
+        return;
+    }
+
+    unsigned before = OccupancyBucket(previousLive, page->Blocks);
+    unsigned after = OccupancyBucket(page->Live, page->Blocks);
+    --Occupancy_[before];
+    ++Occupancy_[after];
+
+    // Bucket b holds the pages with (b-1)*Blocks < 10*Live <= b*Blocks
+    const unsigned tenths = OATelemetry::OCCUPANCY_BUCKETS - 1;
+    page->BucketMin = after == 0 ? 0 : (after - 1) * page->Blocks / tenths + 1;
+    page->BucketMax = after * page->Blocks / tenths;
+
+    // Pages only become empty, or stop being empty, here
+    if (before == 0)
+    {
+        EmptyBlocks_ -= page->Blocks;
+    }
+    else if (after == 0)
+    {
+        EmptyBlocks_ += page->Blocks;
+    }
+}
+
+/**
+ * @brief Gets the telemetry bucket of a page.
+ * @param live The number of blocks in use on the page.
+ * @param blocks The number of blocks on the page.
+ * @return unsigned 0 for an empty page, otherwise i for more than (i-1)/10 and at
+ *         most i/10 of its blocks in use.
+ */
+unsigned ObjectAllocator::OccupancyBucket(unsigned live, unsigned blocks)
+{
+    return (live * (OATelemetry::OCCUPANCY_BUCKETS - 1) + blocks - 1) / blocks;
+}
+
+/**
+ * @brief Puts a page into the bin of its live count (SlabPages_).
+ * Bin 0 holds the empty pages and the last bin the full ones (see BinOf); the bins
+ * in between are the partial pages. FullestPartial_ is raised when the page is the
+ * fullest partial page so far, and lowered past bins that have emptied. It only
+ * moves one bin per block allocated, plus one walk down when a page fills up.
+ * @param page The page, in no bin.
+ */
+void ObjectAllocator::BinPage(PageInfo* page)
+{
+    PageInfo*& head = Bins_[BinOf(page)];
+    page->BinPrev = nullptr;
+    page->BinNext = head;
+    if (head)
+    {
+        head->BinPrev = page;
+    }
+    head = page;
+
+    if (page->Live < page->Blocks && page->Live > FullestPartial_)
+    {
+        FullestPartial_ = page->Live;
+    }
+    while (FullestPartial_ > 0 && !Bins_[FullestPartial_])
+    {
+        --FullestPartial_;
+    }
+}
+
+/**
+ * @brief Gets the bin a page belongs in (SlabPages_).
+ * A page's bin is its live count, except that full pages all go in the last bin.
+ * When pages grow, a full page and a partial bigger page can have the same live
+ * count, and only partial pages may sit in the bins PopSlabBlock takes from.
+ * @param page The page.
+ * @return size_t The index of its bin in Bins_.
+ */
+size_t ObjectAllocator::BinOf(const PageInfo* page) const
+{
+    return page->Live < page->Blocks ? page->Live : Bins_.size() - 1;
+}
+
+/**
+ * @brief Takes a page out of the bin of its live count (SlabPages_).
+ * FullestPartial_ is left for the next BinPage to correct, so moving a page up
+ * one bin never walks the bins.
+ * @param page The page; pages that were never binned are ignored.
+ */
+void ObjectAllocator::UnbinPage(PageInfo* page)
+{
+    PageInfo*& head = Bins_[BinOf(page)];
+    if (head != page && !page->BinPrev)
+    {
+        return;
+    }
+
+    if (page->BinPrev)
+    {
+        page->BinPrev->BinNext = page->BinNext;
+    }
+    else
+    {
+        head = page->BinNext;
+    }
+    if (page->BinNext)
+    {
+        page->BinNext->BinPrev = page->BinPrev;
+    }
+    page->BinPrev = nullptr;
+    page->BinNext = nullptr;
+}
+
+/**
+ * @brief Takes a free block from the fullest page that has one (SlabPages_).
+ * Filling the busiest pages first leaves the emptiest ones to drain, so they can
+ * be released by FreeEmptyPages, and keeps live objects packed on few pages.
+ * An empty page is only used when no page is partly full.
+ * @return void* The block, already marked in use. The caller has made sure
+ *         there is a free block.
+ */
+void* ObjectAllocator::PopSlabBlock()
+{
+    PageInfo* page = Bins_[FullestPartial_];
+    GenericObject* block = page->FreeList;
+    page->FreeList = block->Next;
+
+    size_t index = 0;
+    if (BlockIndex(page, block, index))
+    {
+        SetBlockInUse(page, index, true);
+    }
+    return block;
+}
+
+/**
+ * @brief Marks blocks of one page as owned by the client (not for SlabPages_).
+ * The bits are set and the live count raised for the whole run, and the telemetry
+ * counters follow the page once, instead of block by block.
+ * @param page The page that holds the blocks.
+ * @param blocks The blocks, all on page and all free.
+ * @param count Number of entries in blocks.
+ */
+void ObjectAllocator::MarkBlocksInUse(PageInfo* page, void* const blocks[], unsigned count)
+{
+    unsigned previousLive = page->Live;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        size_t index = 0;
+        if (BlockIndex(page, blocks[i], index))
+        {
+            page->SetInUse(index, true);
+        }
+    }
+    CountOccupancy(page, previousLive);
 }
 
 /**
@@ -608,27 +1570,28 @@ unsigned ObjectAllocator::DumpMemoryInUse(DUMPCALLBACK fn) const
 {
     unsigned count = 0;
 
-
-    for (GenericObject* currentPage = PageList_; currentPage != nullptr; currentPage = currentPage->Next)
+    // Newest page first, as the page list runs
+    for (auto page = Pages_.rbegin(); page != Pages_.rend(); ++page)
     {
+        const PageInfo* currentPage = *page;
         // Calculate the starting position of the first block in the page
-        char* currentBlockPtr = reinterpret_cast<char*>(currentPage) + sizeof(GenericObject*) + Config_.LeftAlignSize_
-            + Config_.HBlockInfo_.size_ + Config_.PadBytes_;
+        char* currentBlockPtr = currentPage->Page + currentPage->FirstBlock;
 
-        // Iterate through each block in the page
-        for (unsigned i = 0; i < Config_.ObjectsPerPage_; ++i)
+        // Iterate through each block in the page, stopping after its last live block
+        unsigned found = 0;
+        for (unsigned i = 0; i < currentPage->Blocks && found < currentPage->Live; ++i)
         {
-            // Check if the block's header indicates it's in use
-            GenericObject* currentBlock = reinterpret_cast<GenericObject*>(currentBlockPtr);
-            if (!CheckErrorFree(currentBlock))
+            // Check if the page's bitmap says the block is in use
+            if (IsBlockInUse(currentPage, i))
             {
                 count++; // Increment the count of blocks in use
+                found++;
                 fn(currentBlockPtr, Stats_.ObjectSize_);
             }
 
             // Move to the next block
             currentBlockPtr += Config_.HBlockInfo_.size_ + (2 * Config_.PadBytes_) + Stats_.ObjectSize_;
-            if (i < Config_.ObjectsPerPage_ - 1)
+            if (i < currentPage->Blocks - 1)
             {
                 currentBlockPtr += Config_.InterAlignSize_;
             }
@@ -650,15 +1613,15 @@ unsigned ObjectAllocator::ValidatePages(VALIDATECALLBACK fn) const
 {
     //tracker
     unsigned corruptedCount = 0;
-    //loop base off the pages
-    for (GenericObject* currentPage = PageList_; currentPage != nullptr; currentPage = currentPage->Next)
+    //loop base off the pages, newest first as the page list runs (Pages_ is oldest first)
+    for (auto page = Pages_.rbegin(); page != Pages_.rend(); ++page)
     {
-        //assign the first block
-        char* currentBlockPtr = reinterpret_cast<char*>(currentPage) + sizeof(GenericObject*) + Config_.LeftAlignSize_
-            + Config_.HBlockInfo_.size_ + Config_.PadBytes_;
+        const PageInfo* currentPage = *page;
+        //assign the first block, which depends on the page's color
+        char* currentBlockPtr = currentPage->Page + currentPage->FirstBlock;
 
         //loop
-        for (unsigned i = 0; i < Config_.ObjectsPerPage_; ++i)
+        for (unsigned i = 0; i < currentPage->Blocks; ++i)
         {
             //check if the current block is corrupted
             GenericObject* currentBlock = reinterpret_cast<GenericObject*>(currentBlockPtr);
@@ -673,7 +1636,7 @@ unsigned ObjectAllocator::ValidatePages(VALIDATECALLBACK fn) const
             //move to the next block in the page
             currentBlockPtr += Config_.HBlockInfo_.size_ + (2 * Config_.PadBytes_) + Stats_.ObjectSize_;
 
-            if (i < Config_.ObjectsPerPage_ - 1)
+            if (i < currentPage->Blocks - 1)
             {   //add back allignment
                 currentBlockPtr += Config_.InterAlignSize_;
             }
@@ -683,31 +1646,465 @@ unsigned ObjectAllocator::ValidatePages(VALIDATECALLBACK fn) const
     return corruptedCount;
 }
 
+/**
+ * @brief Validates the next slice of the heap.
+ * Checks the same blocks as ValidatePages and reports them the same way, but only
+ * up to a budget, and the next call resumes after the last block checked. Pages are
+ * walked from the oldest, so pages added during a pass are checked at its end and
+ * pages freed during a pass don't make the cursor skip any. Calling it regularly with
+ * a budget of B blocks covers a heap of N blocks every N / B calls.
+ * With a time budget the clock is read every few blocks, so a call can run a little
+ * over it. Every call checks at least one block when there is one, even with a
+ * MaxBlocks of 0, so a pass always makes progress.
+ * @param fn The callback for each potentially corrupted block.
+ * @param MaxBlocks The most blocks to check in this call (0 is taken as 1).
+ * @param MaxMicroseconds Stop once about this much time has passed (0 = no time limit).
+ * @return OAValidateSlice How many blocks were checked and reported, and whether a pass ended.
+ */
+OAValidateSlice ObjectAllocator::ValidateSome(VALIDATECALLBACK fn, unsigned MaxBlocks, unsigned MaxMicroseconds)
+{
+    //blocks checked between two reads of the clock
+    const unsigned CLOCK_STRIDE = 32;
+
+    OAValidateSlice slice;
+    auto start = std::chrono::steady_clock::now();
+    if (MaxBlocks == 0)
+    {
+        MaxBlocks = 1;
+    }
+
+    while (slice.Checked_ < MaxBlocks && !Pages_.empty())
+    {
+        if (ValidatePage_ >= Pages_.size())
+        {
+            //pages were freed since the previous call, past the cursor
+            ValidatePage_ = 0;
+            ValidateBlock_ = 0;
+        }
+
+        const PageInfo* page = Pages_[ValidatePage_];
+        char* block = page->Page + page->FirstBlock + ValidateBlock_ * BlockStride_;
+        if (CorruptedCheck(reinterpret_cast<GenericObject*>(block)))
+        {
+            ++slice.Corrupted_;
+            fn(block, Stats_.ObjectSize_);
+        }
+        ++slice.Checked_;
+
+        //move the cursor on, wrapping around after the newest page
+        if (++ValidateBlock_ == page->Blocks)
+        {
+            ValidateBlock_ = 0;
+            if (++ValidatePage_ == Pages_.size())
+            {
+                ValidatePage_ = 0;
+                slice.PassDone_ = true;
+                break;
+            }
+        }
+
+        if (MaxMicroseconds > 0 && slice.Checked_ % CLOCK_STRIDE == 0 &&
+            std::chrono::steady_clock::now() - start >= std::chrono::microseconds(MaxMicroseconds))
+        {
+            break;
+        }
+    }
+
+    return slice;
+}
+
+/**
+ * @brief Calls a callback for each block in use, scanning the pages on several threads.
+ * Gives the same calls, in the same order, as DumpMemoryInUse.
+ * @param fn A callback function that takes two parameters: a pointer to the block and its size.
+ * @param Threads The most threads to scan with, the calling one included (0 = one per core).
+ * @return unsigned The count of blocks in use that the callback function was called for.
+ * @throw OAException Throws an exception if the blocks found can't be collected.
+ */
+unsigned ObjectAllocator::DumpMemoryInUseParallel(DUMPCALLBACK fn, unsigned Threads) const
+{
+    return ScanPagesParallel(true, fn, Threads);
+}
+
+/**
+ * @brief Calls a callback for each potentially corrupted block, scanning the pages on several threads.
+ * Gives the same calls, in the same order, as ValidatePages.
+ * @param fn The callback for each potentially corrupted block.
+ * @param Threads The most threads to scan with, the calling one included (0 = one per core).
+ * @return unsigned The number of corrupted blocks.
+ * @throw OAException Throws an exception if the blocks found can't be collected.
+ */
+unsigned ObjectAllocator::ValidatePagesParallel(VALIDATECALLBACK fn, unsigned Threads) const
+{
+    if (Config_.PadBytes_ == 0)
+    {
+        return 0;
+    }
+    return ScanPagesParallel(false, fn, Threads);
+}
+
+/**
+ * @brief Splits Pages_ into one run of pages per thread and scans the runs at once.
+ * The runs hold about the same number of blocks, however big their pages are.
+ * Each thread only reads its pages and collects the blocks it finds in a list of its
+ * own. Once all have finished the calling thread calls fn for the lists in page order,
+ * so the client sees the order of a single-threaded scan and its callback need not be
+ * thread-safe. A thread gets at least PARALLEL_MIN_BLOCKS blocks, so small heaps (and
+ * single-core machines) get the single-threaded scan. If a thread can't be started the
+ * calling thread scans its pages too.
+ * @param inUse True to find the blocks in use, false to find the corrupted ones.
+ * @param fn The client's callback.
+ * @param threads The most threads to use (0 = one per core).
+ * @return unsigned The number of blocks found.
+ * @throw OAException Throws an exception if the blocks found can't be collected.
+ */
+unsigned ObjectAllocator::ScanPagesParallel(bool inUse, void (*fn)(const void*, size_t), unsigned threads) const
+{
+    if (threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    size_t most = (TotalBlocks_ + PARALLEL_MIN_BLOCKS - 1) / PARALLEL_MIN_BLOCKS;
+    size_t workers = threads < most ? threads : most;
+
+    //one thread gains nothing from collecting the blocks first
+    if (workers <= 1)
+    {
+        return inUse ? DumpMemoryInUse(fn) : ValidatePages(fn);
+    }
+
+    std::vector<std::vector<const void*>> found;
+    std::vector<std::thread> pool;
+    std::vector<char> failed(workers, 0);
+    std::vector<size_t> bounds;
+    try
+    {
+        found.resize(workers);
+        pool.reserve(workers - 1);
+        bounds.assign(workers + 1, Pages_.size());
+    }
+    catch (const std::bad_alloc&)
+    {
+        throw OAException(OAException::E_NO_MEMORY, "ScanPagesParallel: No system memory available.");
+    }
+
+    //worker w scans pages [bounds[w], bounds[w + 1]), runs of about the same number of blocks
+    bounds[0] = 0;
+    size_t next = 1;
+    size_t blocks = 0;
+    for (size_t p = 0; p < Pages_.size() && next < workers; ++p)
+    {
+        blocks += PageAt(p)->Blocks;
+        while (next < workers && blocks * workers >= next * TotalBlocks_)
+        {
+            bounds[next++] = p + 1;
+        }
+    }
+
+    auto scan = [this, inUse, &bounds, &found, &failed](size_t w) {
+        try
+        {
+            ScanPages(inUse, bounds[w], bounds[w + 1], found[w]);
+        }
+        catch (const std::bad_alloc&)
+        {
+            failed[w] = 1;
+        }
+    };
+
+    size_t started = 1;
+    for (; started < workers; ++started)
+    {
+        try
+        {
+            pool.emplace_back(scan, started);
+        }
+        catch (const std::system_error&)
+        {
+            break;
+        }
+    }
+    scan(0);
+    for (size_t w = started; w < workers; ++w)
+    {
+        scan(w);
+    }
+    for (std::thread& worker : pool)
+    {
+        worker.join();
+    }
+
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end())
+    {
+        throw OAException(OAException::E_NO_MEMORY, "ScanPagesParallel: No system memory available.");
+    }
+
+    unsigned count = 0;
+    for (const std::vector<const void*>& blocks : found)
+    {
+        for (const void* block : blocks)
+        {
+            fn(block, Stats_.ObjectSize_);
+            ++count;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Collects the blocks of a run of pages that are in use, or that are corrupted.
+ * @param inUse True to find the blocks in use, false to find the corrupted ones.
+ * @param first The first page, as a position in the page list (see PageAt).
+ * @param last One past the last page.
+ * @param found The blocks found are appended here, in page and block order.
+ * @throw std::bad_alloc If found can't grow.
+ */
+void ObjectAllocator::ScanPages(bool inUse, size_t first, size_t last, std::vector<const void*>& found) const
+{
+    //the live counts say how many blocks in use there are to collect
+    if (inUse)
+    {
+        size_t total = 0;
+        for (size_t p = first; p < last; ++p)
+        {
+            total += PageAt(p)->Live;
+        }
+        found.reserve(found.size() + total);
+    }
+
+    for (size_t p = first; p < last; ++p)
+    {
+        const PageInfo* page = PageAt(p);
+        char* block = page->Page + page->FirstBlock;
+        unsigned live = 0;
+
+        for (unsigned i = 0; i < page->Blocks; ++i, block += BlockStride_)
+        {
+            if (inUse)
+            {
+                //stop after the page's last live block
+                if (live == page->Live)
+                {
+                    break;
+                }
+                if (IsBlockInUse(page, i))
+                {
+                    ++live;
+                    found.push_back(block);
+                }
+            }
+            else if (CorruptedCheck(reinterpret_cast<GenericObject*>(block)))
+            {
+                found.push_back(block);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Gets a page by its position in the page list, newest first.
+ * Pages_ is kept oldest first, so creating a page is a push_back.
+ * @param position 0 for the newest page, up to Pages_.size() - 1 for the oldest.
+ * @return const PageInfo* The page's bookkeeping.
+ */
+const PageInfo* ObjectAllocator::PageAt(size_t position) const
+{
+    return Pages_[Pages_.size() - 1 - position];
+}
+
+/**
+ * @brief Allocates an object and returns a handle to it.
+ * The same as Allocate followed by HandleOf; the object is freed again if it
+ * can't have a handle.
+ * @param label The label of the block (external headers only).
+ * @return OBJECTHANDLE The handle.
+ * @throw OAException As Allocate, or as HandleOf.
+ */
+ObjectAllocator::OBJECTHANDLE ObjectAllocator::AllocateHandle(const char* label)
+{
+    void* object = Allocate(label);
+    try
+    {
+        return HandleOf(object);
+    }
+    catch (...)
+    {
+        Free(object);
+        throw;
+    }
+}
+
+/**
+ * @brief Makes a 32-bit handle to an object in use.
+ * From the high bits down a handle holds the index of the object's page, its
+ * slot on the page and the slot's generation, which every free of the block
+ * bumps. A page gets an index the first time a handle to one of its objects is
+ * made; the index of a freed page goes to the next page that needs one, along
+ * with the generations of its slots, so old handles stay stale. The generation
+ * wraps after 2^bits - 1 frees of the same slot, after which a handle kept that
+ * long would resolve again.
+ * @param Object An object from Allocate that has not been freed.
+ * @return OBJECTHANDLE The handle.
+ * @throw OAException E_BAD_BOUNDARY if Object isn't an object of this allocator,
+ *        E_MULTIPLE_FREE if it is free, E_NO_PAGES if the handle bits can't hold
+ *        another page index (or leave none for the generation, or there are no pages).
+ */
+ObjectAllocator::OBJECTHANDLE ObjectAllocator::HandleOf(void* Object)
+{
+    if (Config_.UseCPPMemManager_ || HandleGenerationBits_ == 0)
+    {
+        throw OAException(OAException::E_NO_PAGES, "HandleOf: There are no handle bits for the pages.");
+    }
+
+    PageInfo* page = FindPage(Object);
+    size_t index = 0;
+    if (!page || !BlockIndex(page, Object, index))
+    {
+        throw OAException(OAException::E_BAD_BOUNDARY, "HandleOf: Object has bad boundary.");
+    }
+    if (!IsBlockInUse(page, index))
+    {
+        throw OAException(OAException::E_MULTIPLE_FREE, "HandleOf: Object has been freed.");
+    }
+
+    //give the page an index, reusing the index of a freed page when there is one
+    if (!page->HandlePage)
+    {
+        unsigned pageIndex;
+        if (!FreeHandlePages_.empty())
+        {
+            pageIndex = FreeHandlePages_.back();
+            FreeHandlePages_.pop_back();
+        }
+        else
+        {
+            if (HandlePages_.size() >> HandlePageBits_)
+            {
+                throw OAException(OAException::E_NO_PAGES, "HandleOf: More pages than handles can address.");
+            }
+            pageIndex = static_cast<unsigned>(HandlePages_.size());
+            HandlePages_.push_back(HandlePageInfo{ nullptr, std::vector<unsigned short>() });
+        }
+
+        HandlePageInfo& handlePage = HandlePages_[pageIndex];
+        if (handlePage.Generations.size() < page->Blocks)
+        {
+            handlePage.Generations.resize(page->Blocks, 1);
+        }
+        handlePage.Page = page;
+        page->HandlePage = pageIndex + 1;
+    }
+
+    OBJECTHANDLE handle = page->HandlePage - 1;
+    handle = (handle << HandleSlotBits_) | static_cast<OBJECTHANDLE>(index);
+    handle = (handle << HandleGenerationBits_) | HandlePages_[page->HandlePage - 1].Generations[index];
+    return handle;
+}
+
+/**
+ * @brief Gets the object a handle refers to.
+ * Splits the handle, looks its page up by index and compares the generation;
+ * any free of the object since the handle was made has changed it.
+ * @param Handle A handle from HandleOf or AllocateHandle.
+ * @return void* The object, or nullptr if it has been freed since (or the handle is invalid).
+ */
+void* ObjectAllocator::Resolve(OBJECTHANDLE Handle) const
+{
+    if (HandleGenerationBits_ == 0)
+    {
+        return nullptr;
+    }
+
+    OBJECTHANDLE generation = Handle & ((1u << HandleGenerationBits_) - 1);
+    Handle >>= HandleGenerationBits_;
+    OBJECTHANDLE slot = HandleSlotBits_ ? Handle & ((1u << HandleSlotBits_) - 1) : 0;
+    OBJECTHANDLE pageIndex = HandleSlotBits_ < 32 ? Handle >> HandleSlotBits_ : 0;
+
+    if (pageIndex >= HandlePages_.size())
+    {
+        return nullptr;
+    }
+    const HandlePageInfo& handlePage = HandlePages_[pageIndex];
+    if (!handlePage.Page || slot >= handlePage.Page->Blocks || handlePage.Generations[slot] != generation)
+    {
+        return nullptr;
+    }
+    return handlePage.Page->Page + handlePage.Page->FirstBlock + slot * BlockStride_;
+}
+
+/**
+ * @brief Frees the object a handle refers to.
+ * The object goes through Free, with all of its checks.
+ * @param Handle A handle from HandleOf or AllocateHandle.
+ * @throw OAException E_MULTIPLE_FREE if the handle is stale or invalid, or
+ *        anything Free throws.
+ */
+void ObjectAllocator::FreeHandle(OBJECTHANDLE Handle)
+{
+    void* object = Resolve(Handle);
+    if (!object)
+    {
+        throw OAException(OAException::E_MULTIPLE_FREE, "FreeHandle: Object has already been freed.");
+    }
+    Free(object);
+}
+
+/**
+ * @brief Installs a callback that follows the allocator's pages.
+ * The callback is called right away for every page that already exists (the first
+ * page is created by the constructor), then each time a page is added or released.
+ * This lets a front end keep its own map from page addresses to allocators.
+ * @param fn The callback, or nullptr to stop the notifications.
+ * @param context Passed back unchanged to every call.
+ */
+void ObjectAllocator::SetPageCallback(PAGECALLBACK fn, void* context)
+{
+    PageCallback_ = fn;
+    PageCallbackContext_ = context;
+
+    if (PageCallback_)
+    {
+        for (auto page = Pages_.rbegin(); page != Pages_.rend(); ++page)
+        {
+            PageCallback_((*page)->Page, PageFootprint(*page), true, PageCallbackContext_);
+        }
+    }
+}
+
 /**
  * @brief Frees all empty pages from the allocator's page list.
  * Iterates through the page list to identify and free pages that do not contain any allocated blocks.
+ * With SlabPages_ an empty page takes its own free list with it.
  * This can help in reducing memory usage by releasing pages that are no longer needed. The function
  * updates the allocator's statistics to reflect changes in the number of pages in use and the number
- * of free objects.
+ * of free objects. Emptiness is read from each page's live count, the free blocks of all empty
+ * pages leave the free list in a single pass, and the empty pages leave Pages_ and PageIndex_
+ * together in CompactPages, so the call is linear in the size of the heap.
  * @return unsigned int The number of pages that were freed during the operation.
  */
 unsigned ObjectAllocator::FreeEmptyPages()
 {
     unsigned int freedPageCount = 0;
     GenericObject** currentPtrRef = &PageList_; // Pointer to pointer to iterate and modify the page list
+    size_t infoIndex = Pages_.size() - 1; // Pages_ is PageList_ in reverse
+
+    // Take the blocks of every empty page off the free list before any page goes away
+    freeEmptyPageBlocks();
 
     while (*currentPtrRef)
     {
         GenericObject* currentPage = *currentPtrRef;
-        if (PageIsEmpty(currentPage))
+        if (Pages_[infoIndex]->Live == 0)
         {
             GenericObject* nextPage = currentPage->Next;
 
-            // Free all blocks in the page, assuming freeBlocks is a function that properly clears blocks from the free list
-            freeBlocks(currentPage);
-
-            // Deallocate the page
-            delete[] reinterpret_cast<char*>(currentPage);
+            // Drop the page from the lookups, then deallocate the page (its bookkeeping goes in CompactPages)
+            PageInfo* info = Pages_[infoIndex];
+            unsigned blocks = info->Blocks;
+            --Occupancy_[0];
+            EmptyBlocks_ -= blocks;
+            UnregisterPage(info);
+            FreePageMemory(reinterpret_cast<char*>(currentPage));
 
             // Update the page list to bypass the deleted page
             *currentPtrRef = nextPage;
@@ -715,66 +2112,52 @@ unsigned ObjectAllocator::FreeEmptyPages()
             //update statistics
             ++freedPageCount;
             --Stats_.PagesInUse_;
-            Stats_.FreeObjects_ -= Config_.ObjectsPerPage_;
+            Stats_.FreeObjects_ -= blocks;
+            TotalBlocks_ -= blocks;
+            ++PagesFreed_;
+            --infoIndex;
 
         }
         else
         {
             currentPtrRef = &(*currentPtrRef)->Next;
+            --infoIndex;
         }
     }
 
+    if (freedPageCount)
+    {
+        CompactPages();
+    }
     return freedPageCount;
 }
 /**
  * @brief Checks if a given page is empty (i.e., all blocks within the page are free).
- * This function iterates through all blocks in a specified page to determine if the page
- * contains no allocated blocks. A page is considered empty if all its blocks are part of
- * the free list.
+ * Reads the page's live count, which Allocate and Free keep up to date.
  * @param page A pointer to the page to check.
  * @return bool True if the page is empty; otherwise, false.
  */
 bool ObjectAllocator::PageIsEmpty(GenericObject* page) const
 {
-    char* blockPtr = reinterpret_cast<char*>(page) + sizeof(GenericObject*) + Config_.LeftAlignSize_ + Config_.HBlockInfo_.size_ + Config_.PadBytes_;
-    for (unsigned i = 0; i < Config_.ObjectsPerPage_; ++i)
-    {
-        GenericObject* currentBlock = reinterpret_cast<GenericObject*>(blockPtr);
-
-        if (!IsBlockFree(currentBlock))
-        {
-            return false;
-        }
-
-
-        blockPtr += Config_.HBlockInfo_.size_ + (2 * Config_.PadBytes_) + Stats_.ObjectSize_;
-
-        //check if its not last
-        if (i < Config_.ObjectsPerPage_ - 1)
-        {
-            blockPtr += Config_.InterAlignSize_;
-        }
-    }
-    return true;
+    const PageInfo* info = FindPage(page);
+    return info && info->Live == 0;
 }
 /**
  * @brief Determines if a specific block is free (i.e., part of the free list).
- * This function checks whether a given block is currently part of the allocator's
- * free list, indicating that the block is available for allocation.
+ * The block's page is located and its bit in the page's in-use bitmap is read,
+ * so the answer does not depend on the length of the free list.
  * @param block A pointer to the block to check.
- * @return bool True if the block is part of the free list; otherwise, false.
+ * @return bool True if the block is a block of one of the pages and not in use; otherwise, false.
  */
 bool ObjectAllocator::IsBlockFree(GenericObject* block) const
 {
-    // Iterate through the FreeList_ to see if the block is part of it
-    for (GenericObject* freeBlock = FreeList_; freeBlock != nullptr; freeBlock = freeBlock->Next)
+    const PageInfo* page = FindPage(block);
+    size_t index = 0;
+    if (!page || !BlockIndex(page, block, index))
     {
-        if (freeBlock == block)
-        {
-            return true; // Found the block in the FreeList_
-        }
+        return false;
     }
-    return false; // Block is not in the FreeList_, hence it's allocated
+    return !IsBlockInUse(page, index);
 }
 /**
  * @brief Removes all free blocks within a specified page from the free list.
@@ -788,11 +2171,17 @@ void ObjectAllocator::freeBlocks(GenericObject* block)
 {
     GenericObject** freePtrRef = &FreeList_; // Pointer to a pointer for direct list manipulation
 
+    const PageInfo* page = FindPage(block);
+    if (!page)
+    {
+        return;
+    }
+
     while (*freePtrRef)
     {
         // Calculate the start of the page for the current block
         char* startOfPage = reinterpret_cast<char*>(block);
-        char* endOfPage = startOfPage + Stats_.PageSize_;
+        char* endOfPage = startOfPage + page->Size;
 
         // Check if the current free block is within the page to be freed
         if (reinterpret_cast<char*>(*freePtrRef) >= startOfPage && reinterpret_cast<char*>(*freePtrRef) < endOfPage)
@@ -809,6 +2198,29 @@ void ObjectAllocator::freeBlocks(GenericObject* block)
     }
 }
 
+/**
+ * @brief Removes the free blocks of every empty page from the free list.
+ * One walk over the free list; each block's page is looked up and the block is
+ * dropped when that page has no live blocks. The remaining blocks keep their order.
+ */
+void ObjectAllocator::freeEmptyPageBlocks()
+{
+    GenericObject** freePtrRef = &FreeList_;
+
+    while (*freePtrRef)
+    {
+        const PageInfo* page = FindPage(*freePtrRef);
+        if (page && page->Live == 0)
+        {
+            *freePtrRef = (*freePtrRef)->Next;
+        }
+        else
+        {
+            freePtrRef = &(*freePtrRef)->Next;
+        }
+    }
+}
+
 //******Testing member functions********/
 /**
  * @brief Sets the debug state of the allocator.
@@ -826,7 +2238,8 @@ void ObjectAllocator::SetDebugState(bool state)
  * @brief Gets a pointer to the internal free list.
  * The free list contains blocks of memory that have been allocated but are
  * currently not in use. This function provides read-only access to the start
- * of the free list, allowing inspection without modification.
+ * of the free list, allowing inspection without modification. With SlabPages_
+ * the free blocks are kept per page and this list is always empty.
  * @return const void* A constant pointer to the first block in the free list.
  */
 const void* ObjectAllocator::GetFreeList() const
@@ -846,6 +2259,16 @@ const void* ObjectAllocator::GetPageList() const
     return PageList_;
 }
 
+/**
+ * @brief Gets the number of blocks on all pages.
+ * Equal to PagesInUse_ * ObjectsPerPage_ unless pages grow (MaxObjectsPerPage_).
+ * @return unsigned The number of blocks, whether in use, free or held by a front end.
+ */
+unsigned ObjectAllocator::Capacity() const
+{
+    return TotalBlocks_;
+}
+
 /**
  * @brief Retrieves the current configuration settings of the allocator.
  * This function returns a copy of the allocator's configuration settings, which
@@ -870,5 +2293,102 @@ OAStats ObjectAllocator::GetStats() const
     return Stats_;
 }
 
+/**
+ * @brief Takes a telemetry snapshot.
+ * Everything is read from counters kept up to date as blocks and pages come and go,
+ * so a snapshot costs the same whatever the size of the heap. Rates are the change
+ * in the totals over the time between Since and now. Pages handed to a front end
+ * (TakeFreeList) count as empty, as the allocator doesn't see their blocks in use.
+ * @param Since An earlier snapshot of this allocator, or null to measure the rates
+ *        since it was made.
+ * @return OATelemetry The snapshot.
+ */
+OATelemetry ObjectAllocator::GetTelemetry(const OATelemetry* Since) const
+{
+    OATelemetry telemetry;
+    telemetry.Seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - Created_).count();
+    telemetry.PagesInUse_ = Stats_.PagesInUse_;
+    for (unsigned i = 0; i < OATelemetry::OCCUPANCY_BUCKETS; ++i)
+    {
+        telemetry.Occupancy_[i] = Occupancy_[i];
+    }
+    telemetry.Capacity_ = TotalBlocks_;
+    telemetry.ObjectsInUse_ = Stats_.ObjectsInUse_;
+    //full pages have no free blocks, so the free blocks not on empty pages are on partial ones
+    //(new/delete has no pages, and its objects aren't on any)
+    unsigned partialFree = Config_.UseCPPMemManager_ ? 0 : TotalBlocks_ - Stats_.ObjectsInUse_ - EmptyBlocks_;
+    telemetry.FreeBytesInPartialPages_ = partialFree * Stats_.ObjectSize_;
+    telemetry.TotalBytes_ = TotalBlocks_ * Stats_.ObjectSize_;
+    if (telemetry.TotalBytes_ > 0)
+    {
+        telemetry.Fragmentation_ = static_cast<double>(telemetry.FreeBytesInPartialPages_) / telemetry.TotalBytes_;
+    }
+    telemetry.PagesCreated_ = PagesCreated_;
+    telemetry.PagesFreed_ = PagesFreed_;
+    telemetry.Allocations_ = Stats_.Allocations_;
+    telemetry.Deallocations_ = Stats_.Deallocations_;
+
+    //unsigned differences stay right when a total wraps between the snapshots
+    unsigned allocations = telemetry.Allocations_;
+    unsigned deallocations = telemetry.Deallocations_;
+    unsigned churn = telemetry.PagesCreated_ + telemetry.PagesFreed_;
+    telemetry.Interval_ = telemetry.Seconds_;
+    if (Since)
+    {
+        allocations -= Since->Allocations_;
+        deallocations -= Since->Deallocations_;
+        churn -= Since->PagesCreated_ + Since->PagesFreed_;
+        telemetry.Interval_ -= Since->Seconds_;
+    }
+    if (telemetry.Interval_ > 0)
+    {
+        telemetry.AllocationRate_ = allocations / telemetry.Interval_;
+        telemetry.DeallocationRate_ = deallocations / telemetry.Interval_;
+        telemetry.PageChurnRate_ = churn / telemetry.Interval_;
+    }
+    return telemetry;
+}
+
+/**
+ * @brief Writes a telemetry snapshot as text.
+ * One "<Prefix>_<name> <value>" line per value, in the plain text format metrics
+ * scrapers read; the histogram is one line per bucket, labelled with the most
+ * blocks in use (in percent) a page in it can have.
+ * @param Prefix The start of every metric name.
+ * @return std::string The lines.
+ */
+std::string OATelemetry::ToText(const char* Prefix) const
+{
+    std::string text;
+    char line[160];
+    auto add = [&](const char* name, double value)
+    {
+        snprintf(line, sizeof(line), "%s_%s %.10g\n", Prefix, name, value);
+        text += line;
+    };
+
+    add("seconds", Seconds_);
+    add("pages_in_use", PagesInUse_);
+    for (unsigned i = 0; i < OCCUPANCY_BUCKETS; ++i)
+    {
+        snprintf(line, sizeof(line), "%s_page_occupancy{max_percent=\"%u\"} %u\n", Prefix,
+            i * 100 / (OCCUPANCY_BUCKETS - 1), Occupancy_[i]);
+        text += line;
+    }
+    add("capacity_blocks", Capacity_);
+    add("objects_in_use", ObjectsInUse_);
+    add("free_bytes_in_partial_pages", static_cast<double>(FreeBytesInPartialPages_));
+    add("total_bytes", static_cast<double>(TotalBytes_));
+    add("fragmentation_ratio", Fragmentation_);
+    add("pages_created_total", PagesCreated_);
+    add("pages_freed_total", PagesFreed_);
+    add("allocations_total", Allocations_);
+    add("deallocations_total", Deallocations_);
+    add("allocation_rate", AllocationRate_);
+    add("deallocation_rate", DeallocationRate_);
+    add("page_churn_rate", PageChurnRate_);
+    return text;
+}
+
 
 
@@ -14,7 +14,14 @@
 #define OBJECTALLOCATORH
 //---------------------------------------------------------------------------
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 
 // If the client doesn't specify these:
 static const int DEFAULT_OBJECTS_PER_PAGE = 4;  
@@ -87,6 +94,7 @@ struct OAConfig
 {
   static const size_t BASIC_HEADER_SIZE = sizeof(unsigned) + 1; //!< allocation number + flags
   static const size_t EXTERNAL_HEADER_SIZE = sizeof(void*);     //!< just a pointer
+  static const size_t CACHE_LINE_SIZE = 64;                      //!< step between page colors
 
   /*!
     The different types of header blocks
@@ -165,6 +173,14 @@ struct OAConfig
     HBlockInfo_ = HBInfo;
     LeftAlignSize_ = 0;  
     InterAlignSize_ = 0;
+    AlignPages_ = false;
+    OSPages_ = false;
+    HugePages_ = false;
+    SlabPages_ = false;
+    Colors_ = 0;
+    PageHeaderSize_ = 0;
+    MaxObjectsPerPage_ = 0;
+    Arena_ = false;
   }
 
   bool UseCPPMemManager_;      //!< by-pass the functionality of the OA and use new/delete
@@ -176,6 +192,14 @@ struct OAConfig
   unsigned Alignment_;         //!< address alignment of each block
   unsigned LeftAlignSize_;     //!< number of alignment bytes required to align first block
   unsigned InterAlignSize_;    //!< number of alignment bytes required between remaining blocks
+  bool AlignPages_;            //!< place pages on power-of-two boundaries so a block's page is address & mask
+  bool OSPages_;               //!< take pages from the OS (mmap/VirtualAlloc) and give them back when freed
+  bool HugePages_;             //!< like OSPages_, carving pages out of 2 MB huge-page chunks
+  bool SlabPages_;             //!< every page keeps its own free list and Allocate uses the fullest page with room
+  unsigned Colors_;            //!< successive pages shift their first block by 0..Colors_-1 cache lines (0 or 1=off)
+  unsigned PageHeaderSize_;    //!< bytes after each page's link left to the client (e.g. to tag the page's owner)
+  unsigned MaxObjectsPerPage_; //!< each new page holds twice as many objects as the last, up to this many (0=off)
+  bool Arena_;                 //!< carve the pages out of one region of MaxPages_ pages made by the constructor
 };
 
 
@@ -200,6 +224,57 @@ struct OAStats
   unsigned Deallocations_; //!< total requests to free memory
 };
 
+/*!
+  POD that reports one slice of an incremental validation
+*/
+struct OAValidateSlice
+{
+  /*!
+    Constructor
+  */
+  OAValidateSlice() : Checked_(0), Corrupted_(0), PassDone_(false) {};
+
+  unsigned Checked_;   //!< number of blocks checked by this call
+  unsigned Corrupted_; //!< number of them reported to the callback
+  bool PassDone_;      //!< the call reached the last page; the next call starts a new pass from the oldest page
+};
+
+/*!
+  POD that holds a snapshot of the allocator's occupancy, fragmentation and rates
+*/
+struct OATelemetry
+{
+  static const unsigned OCCUPANCY_BUCKETS = 11; //!< empty, then one bucket per tenth of a page
+
+  /*!
+    Constructor
+  */
+  OATelemetry() : Seconds_(0), Interval_(0), PagesInUse_(0), Occupancy_(), Capacity_(0), ObjectsInUse_(0),
+                  FreeBytesInPartialPages_(0), TotalBytes_(0), Fragmentation_(0), PagesCreated_(0),
+                  PagesFreed_(0), Allocations_(0), Deallocations_(0), AllocationRate_(0),
+                  DeallocationRate_(0), PageChurnRate_(0) {};
+
+  // Writes the snapshot as one "<Prefix>_<name> <value>" line per value, for a metrics scraper
+  std::string ToText(const char* Prefix = "objectallocator") const;
+
+  double Seconds_;                         //!< seconds since the allocator was made
+  double Interval_;                        //!< seconds the rates are measured over
+  unsigned PagesInUse_;                    //!< number of pages allocated
+  unsigned Occupancy_[OCCUPANCY_BUCKETS];  //!< pages by blocks in use: [0] none, [i] over (i-1)/10 and at most i/10 of them
+  unsigned Capacity_;                      //!< blocks on all pages, in use or not
+  unsigned ObjectsInUse_;                  //!< number of objects in use by client
+  size_t FreeBytesInPartialPages_;         //!< object bytes of the free blocks on pages neither empty nor full
+  size_t TotalBytes_;                      //!< object bytes of all blocks
+  double Fragmentation_;                   //!< FreeBytesInPartialPages_ / TotalBytes_ (0 without pages)
+  unsigned PagesCreated_;                  //!< total pages created
+  unsigned PagesFreed_;                    //!< total pages freed
+  unsigned Allocations_;                   //!< total requests to allocate memory
+  unsigned Deallocations_;                 //!< total requests to free memory
+  double AllocationRate_;                  //!< allocations per second over Interval_
+  double DeallocationRate_;                //!< frees per second over Interval_
+  double PageChurnRate_;                   //!< pages created and freed per second over Interval_
+};
+
 /*!
   This allows us to easily treat raw objects as nodes in a linked list
 */
@@ -214,10 +289,149 @@ struct GenericObject
 struct MemBlockInfo
 {
   bool in_use;        //!< Is the block free or in use?
-  char *label;        //!< A dynamically allocated NUL-terminated string
+  char *label;        //!< A NUL-terminated string, shared by every block with the same label
   unsigned alloc_num; //!< The allocation number (count) of this block
 };
 
+/*!
+  Bookkeeping kept beside each page (the page layout itself is untouched)
+*/
+struct PageInfo
+{
+  char *Page;                       //!< Start of the page (its GenericObject link)
+  std::vector<unsigned char> InUse; //!< One bit per block, set while the client owns it
+  unsigned Live;                    //!< Number of bits set in InUse (0 = the page is empty)
+  size_t FirstBlock;                //!< Offset of the first block from Page (the page's color included)
+  GenericObject *FreeList;          //!< Free blocks of this page (SlabPages_ only)
+  PageInfo *BinPrev;                //!< Previous page with the same live count (SlabPages_ only)
+  PageInfo *BinNext;                //!< Next page with the same live count (SlabPages_ only)
+  unsigned Blocks;                  //!< Number of blocks on the page (more than ObjectsPerPage_ once pages grow)
+  size_t Size;                      //!< Bytes from Page to the end of its last block
+  unsigned BucketMin;               //!< Fewest blocks in use that keep the page in its OATelemetry occupancy bucket
+  unsigned BucketMax;               //!< Most blocks in use that keep the page in that bucket
+  unsigned HandlePage;              //!< 1 + the page's index in handles (0 = no handle made on it yet)
+
+  /*!
+    Describes a page whose blocks are all free and unbinned
+
+    \param page
+      Start of the page.
+
+    \param firstBlock
+      Offset of the first block from page.
+
+    \param blocks
+      Number of blocks on the page.
+
+    \param size
+      Bytes from page to the end of its last block.
+  */
+  PageInfo(char *page, size_t firstBlock, unsigned blocks, size_t size)
+    : Page(page), InUse((blocks + 7) / 8, 0), Live(0), FirstBlock(firstBlock), FreeList(nullptr),
+      BinPrev(nullptr), BinNext(nullptr), Blocks(blocks), Size(size), BucketMin(0), BucketMax(0), HandlePage(0)
+  {
+  }
+
+  /*!
+    Converts a block address into its index on the page
+
+    \param block
+      Address handed out to (or returned by) the client.
+
+    \param stride
+      Distance between the starts of two neighbouring blocks.
+
+    \param index
+      Receives the block index when the address is a block start.
+
+    eturn
+      True if the address is exactly the start of one of the page's blocks.
+  */
+  bool IndexOf(const void *block, size_t stride, size_t &index) const
+  {
+    const char *blockPtr = static_cast<const char *>(block);
+    if (blockPtr < Page + FirstBlock)
+      return false;
+
+    size_t offset = static_cast<size_t>(blockPtr - (Page + FirstBlock));
+    if (offset % stride != 0 || offset / stride >= Blocks)
+      return false;
+
+    index = offset / stride;
+    return true;
+  }
+
+  bool IsInUse(size_t index) const { return (InUse[index >> 3] & (1u << (index & 7))) != 0; } //!< is the block owned by the client?
+
+  /*!
+    Sets or clears a block's bit in InUse and counts it in Live (the state
+    must change)
+  */
+  void SetInUse(size_t index, bool inUse)
+  {
+    unsigned char bit = static_cast<unsigned char>(1u << (index & 7));
+    if (inUse)
+    {
+      InUse[index >> 3] |= bit;
+      ++Live;
+    }
+    else
+    {
+      InUse[index >> 3] &= static_cast<unsigned char>(~bit);
+      --Live;
+    }
+  }
+
+  /*!
+    Finds the page that holds an address in pages sorted by address
+
+    \param sorted
+      Pages sorted by their start, as Insert keeps them.
+
+    \param address
+      Any address.
+
+    eturn
+      The page whose Size bytes hold the address, or nullptr.
+  */
+  static PageInfo *Find(const std::vector<PageInfo *> &sorted, const void *address)
+  {
+    const char *addressPtr = static_cast<const char *>(address);
+
+    //first page that starts after the address, the owner (if any) is the one before it
+    auto next = std::upper_bound(sorted.begin(), sorted.end(), addressPtr,
+      [](const char *lhs, const PageInfo *rhs) { return std::less<const char *>()(lhs, rhs->Page); });
+    if (next == sorted.begin())
+      return nullptr;
+
+    PageInfo *page = *(next - 1);
+    return addressPtr < page->Page + page->Size ? page : nullptr;
+  }
+
+  /*!
+    Adds a page to pages sorted by address, for Find
+  */
+  static void Insert(std::vector<PageInfo *> &sorted, PageInfo *page)
+  {
+    auto position = std::upper_bound(sorted.begin(), sorted.end(), page,
+      [](const PageInfo *lhs, const PageInfo *rhs) { return std::less<const char *>()(lhs->Page, rhs->Page); });
+    sorted.insert(position, page);
+  }
+};
+
+/*!
+  A page index of the handle API: the page that has it now and the
+  generation of each of its slots, kept when the page goes so stale
+  handles stay stale when another page takes the index
+*/
+struct HandlePageInfo
+{
+  PageInfo *Page;                           //!< Page with this index (null while no page has it)
+  std::vector<unsigned short> Generations;  //!< Generation of each slot, bumped whenever its block is freed
+};
+
+class OSPageProvider;
+
 /*!
   This class represents a custom memory manager
 */
@@ -227,6 +441,8 @@ public:
     // Defined by the client (pointer to a block, size of block)
     typedef void (*DUMPCALLBACK)(const void*, size_t);     //!< Callback function when dumping memory leaks
     typedef void (*VALIDATECALLBACK)(const void*, size_t); //!< Callback function when validating blocks
+    // Defined by the client (start of a page, bytes reserved for it, true=added/false=released, client context)
+    typedef void (*PAGECALLBACK)(const void*, size_t, bool, void*); //!< Callback function when pages come and go
 
     // Predefined values for memory signatures
     static const unsigned char UNALLOCATED_PATTERN = 0xAA; //!< New memory never given to the client
@@ -234,6 +450,12 @@ public:
     static const unsigned char FREED_PATTERN = 0xCC; //!< Memory returned by the client
     static const unsigned char PAD_PATTERN = 0xDD; //!< Pad signature to detect buffer over/under flow
     static const unsigned char ALIGN_PATTERN = 0xEE; //!< For the alignment bytes
+    static const unsigned HEADERS_PER_PAGE = 128; //!< MemBlockInfo records per page of the hbExternal header pool
+    static const unsigned PARALLEL_MIN_BLOCKS = 16384; //!< fewest blocks worth a thread of their own in a parallel scan
+    static const unsigned HANDLE_GENERATION_BITS = 8; //!< generation bits of a handle when MaxPages_ is unlimited (up to 16 otherwise)
+
+    // 32-bit reference to a block: page index, slot on the page and generation (0 is never a handle)
+    typedef uint32_t OBJECTHANDLE;
 
     // Creates the ObjectManager per the specified values
     // Throws an exception if the construction fails. (Memory allocation problem)
@@ -250,23 +472,94 @@ public:
     // Throws an exception if the the object can't be freed. (Invalid object)
     void Free(void* Object);
 
+    // Takes Count objects at once, in the order Count calls to Allocate without a label would
+    // Throws an exception if they can't all be allocated, in which case none are taken.
+    void AllocateBatch(unsigned Count, void* Objects[]);
+
+    // Creates pages until at least Objects objects can be allocated without creating another
+    // Throws an exception if that would pass MaxPages_, in which case no page is created.
+    void Reserve(unsigned Objects);
+
+    // Allocates an object and returns a handle to it instead of its address
+    // Throws an exception if the object can't be allocated or has no handle. (Memory allocation problem)
+    OBJECTHANDLE AllocateHandle(const char* label = 0);
+
+    // Returns a handle to an object in use
+    // Throws an exception if Object isn't one, or the pages leave no bits for the generation
+    OBJECTHANDLE HandleOf(void* Object);
+
+    // Returns the object a handle refers to, or nullptr once the object has been freed (never throws)
+    void* Resolve(OBJECTHANDLE Handle) const;
+
+    // Frees the object a handle refers to, as Free does
+    // Throws an exception if the handle is stale (the object was freed) or invalid
+    void FreeHandle(OBJECTHANDLE Handle);
+
+    // Returns Count objects at once (nullptr entries are skipped)
+    // Throws an exception if any object can't be freed, in which case none are freed.
+    void FreeBatch(void* const Objects[], unsigned Count);
+
     // Calls the callback fn for each block still in use
     unsigned DumpMemoryInUse(DUMPCALLBACK fn) const;
 
     // Calls the callback fn for each block that is potentially corrupted
     unsigned ValidatePages(VALIDATECALLBACK fn) const;
 
-    size_t CalculatePadding(size_t size, size_t alignment);
-    size_t CalculateTotalPageSize(size_t pointerSize, size_t leftAlignSize,size_t block_size, size_t objectsPerPage,
-                                  size_t interAlignSize) const;
+    // Like ValidatePages, but checks at most MaxBlocks blocks, at least one (and stops after
+    // about MaxMicroseconds when not 0), carrying on where the previous call stopped
+    OAValidateSlice ValidateSome(VALIDATECALLBACK fn, unsigned MaxBlocks, unsigned MaxMicroseconds = 0);
+
+    // Like DumpMemoryInUse and ValidatePages, with the pages split over Threads threads
+    // (0 = one per core); fn is called on the calling thread, in the same order
+    // Throws an exception if the results can't be collected. (Memory allocation problem)
+    unsigned DumpMemoryInUseParallel(DUMPCALLBACK fn, unsigned Threads = 0) const;
+    unsigned ValidatePagesParallel(VALIDATECALLBACK fn, unsigned Threads = 0) const;
+
+    // Calls fn for every existing page now, then whenever a page is added or released
+    void SetPageCallback(PAGECALLBACK fn, void* context);
+
+    // Block checks and formatting shared with BasicObjectAllocator, which lays pages out the same way
+    static bool PadsCorrupted(const void* Object, size_t ObjectSize, size_t PadBytes);
+    static void FormatBlock(void* Object, size_t ObjectSize, size_t PadBytes, size_t InterAlignSize);
+    static void WriteHeader(void* Object, const OAConfig::HeaderBlockInfo& Header, size_t PadBytes,
+                            unsigned AllocationNumber, bool Allocated);
+
+    static constexpr size_t CalculatePadding(size_t size, size_t alignment);
+    static constexpr size_t CalculateTotalPageSize(size_t pointerSize, size_t leftAlignSize,size_t block_size, size_t objectsPerPage,
+                                                   size_t interAlignSize);
     bool CheckErrorFree(GenericObject* block) const;
     bool CorruptedCheck(GenericObject* block) const;
     bool CheckBlockBoundary(void* block);
     void freeBlocks(GenericObject* block);
+    void freeEmptyPageBlocks();
     bool PageIsEmpty(GenericObject* page) const;
     bool IsBlockFree(GenericObject* block) const;
-    void BlockHeaderCheck(void* allocatedBlock, const char* label) const;
-    void BlockHeaderCheckFree(void* allocatedBlock) const;
+    void BlockHeaderCheck(void* allocatedBlock, const char* label);
+    void BlockHeaderCheckFree(void* allocatedBlock);
+    MemBlockInfo* NewExternalHeader();
+    char* InternLabel(const char* label);
+    unsigned ScanPagesParallel(bool inUse, void (*fn)(const void*, size_t), unsigned threads) const;
+    void ScanPages(bool inUse, size_t first, size_t last, std::vector<const void*>& found) const;
+    const PageInfo* PageAt(size_t position) const;
+    PageInfo* FindPage(const void* address) const;
+    char* AllocatePageMemory(size_t size);
+    unsigned PageBlocks(unsigned pages) const;
+    unsigned PagesNeeded(unsigned Objects, const char* caller) const;
+    size_t PageFootprint(const PageInfo* page) const;
+    void FreePageMemory(char* page);
+    void RegisterPage(PageInfo* page);
+    void UnregisterPage(PageInfo* page);
+    void CompactPages();
+    bool BlockIndex(const PageInfo* page, const void* block, size_t& index) const;
+    bool IsBlockInUse(const PageInfo* page, size_t index) const;
+    void SetBlockInUse(PageInfo* page, size_t index, bool inUse);
+    void MarkBlocksInUse(PageInfo* page, void* const blocks[], unsigned count);
+    void BinPage(PageInfo* page);
+    void UnbinPage(PageInfo* page);
+    size_t BinOf(const PageInfo* page) const;
+    void CountOccupancy(PageInfo* page, unsigned previousLive);
+    static unsigned OccupancyBucket(unsigned live, unsigned blocks);
+    void* PopSlabBlock();
      
     // Frees all empty page
     unsigned FreeEmptyPages();
@@ -275,13 +568,20 @@ public:
     void SetDebugState(bool State);   // true=enable, false=disable
     const void *GetFreeList() const;  // returns a pointer to the internal free list
     const void *GetPageList() const;  // returns a pointer to the internal page list
+    unsigned Capacity() const;        // returns the number of blocks on all pages, in use or not
     OAConfig GetConfig() const;       // returns the configuration parameters
     OAStats GetStats() const;         // returns the statistics for the allocator
 
+    // Returns occupancy, fragmentation and rates, the rates measured since Since was taken
+    // (or since the allocator was made when Since is null)
+    OATelemetry GetTelemetry(const OATelemetry* Since = nullptr) const;
+
       // Prevent copy construction and assignment
     ObjectAllocator(const ObjectAllocator &oa) = delete;            //!< Do not implement!
     ObjectAllocator &operator=(const ObjectAllocator &oa) = delete; //!< Do not implement!
     void AllocateNewPage();
+    GenericObject* CreatePage(GenericObject*& tail);
+    GenericObject* TakeFreeList();
   private:
       // Some "suggested" members (only a suggestion!)
     //GenericObject *PageList_; //!< the beginning of the list of pages
@@ -296,7 +596,132 @@ public:
     //    // Some "suggested" members (only a suggestion!)
     GenericObject* PageList_{}; //!< the beginning of the list of pages
       GenericObject* FreeList_{}; //!< the beginning of the list of objects
+      std::vector<PageInfo*> Pages_{}; //!< per-page bookkeeping, oldest first (PageList_ in reverse)
+      std::vector<PageInfo*> PageIndex_{}; //!< the same pages sorted by address, for binary search
+      std::unordered_map<const char*, PageInfo*> PageMap_{}; //!< aligned pages keyed by their base address
+      mutable PageInfo* LastPage_{}; //!< page hit by the last lookup (blocks come off the same page in runs)
+      size_t PageFootprint_{}; //!< bytes reserved per page (a power of two when pages are aligned)
+      OSPageProvider* PageProvider_{}; //!< source of page memory with OSPages_/HugePages_, otherwise null
+      PAGECALLBACK PageCallback_{}; //!< told about every page added or released (may be null)
+      void* PageCallbackContext_{}; //!< passed back to PageCallback_
+      size_t FirstBlockOffset_{}; //!< offset of the first block from the start of a page of color 0
+      size_t BlockStride_{}; //!< distance between the starts of two neighbouring blocks
+      size_t ColorStep_{}; //!< bytes between two page colors (cache lines, a multiple of the alignment)
+      unsigned NextColor_{}; //!< color of the next page created
+      ObjectAllocator* HeaderPool_{}; //!< hbExternal: supplies the pages the MemBlockInfo records live on
+      GenericObject* FreeHeaders_{}; //!< hbExternal: MemBlockInfo records not attached to a block
+      std::unordered_set<std::string> Labels_{}; //!< hbExternal: every distinct label, stored once
+      const char* LastLabel_{}; //!< hbExternal: label passed to the last Allocate
+      char* LastInterned_{}; //!< hbExternal: its interned copy
+      std::vector<PageInfo*> Bins_{}; //!< SlabPages_: pages by live count, [0] empty ... [last] full
+      unsigned FullestPartial_{}; //!< SlabPages_: highest live count of a page that still has room (0 = none)
+      size_t ValidatePage_{}; //!< ValidateSome: next page to check, as an index into Pages_ (oldest first)
+      unsigned ValidateBlock_{}; //!< ValidateSome: next block to check on that page
+      unsigned TotalBlocks_{}; //!< blocks on all pages
+      std::vector<GenericObject*> BatchBlocks_{}; //!< FreeBatch: the blocks, sorted (kept to reuse its capacity)
+      std::vector<PageInfo*> BatchPages_{}; //!< FreeBatch: page of each block
+      std::vector<size_t> BatchIndices_{}; //!< FreeBatch: index of each block on its page
+      char* ArenaMemory_{}; //!< Arena_: the region as allocated
+      char* ArenaBase_{}; //!< Arena_: first page slot (aligned on PageFootprint_ with AlignPages_)
+      std::vector<PageInfo*> ArenaPages_{}; //!< Arena_: page in each slot, null for unused slots
+      std::vector<unsigned> ArenaFree_{}; //!< Arena_: unused slots, lowest last
+      unsigned Occupancy_[OATelemetry::OCCUPANCY_BUCKETS]{}; //!< pages in each OccupancyBucket
+      unsigned EmptyBlocks_{}; //!< blocks on empty pages
+      unsigned PagesCreated_{}; //!< total pages created
+      unsigned PagesFreed_{}; //!< total pages freed
+      std::chrono::steady_clock::time_point Created_{ std::chrono::steady_clock::now() }; //!< when the allocator was made
+      std::vector<HandlePageInfo> HandlePages_{}; //!< handles: page indices given out so far
+      std::vector<unsigned> FreeHandlePages_{}; //!< handles: indices whose page was freed
+      unsigned HandleSlotBits_{}; //!< handles: bits of the slot on the page
+      unsigned HandlePageBits_{}; //!< handles: bits of the page index
+      unsigned HandleGenerationBits_{}; //!< handles: bits of the generation (0 = handles can't be made)
+
+};
 
+/**
+ * @brief Calculates the total page size needed based on configuration and object size.
+ * This function computes the total size of a page, including space for the object, header,
+ * padding, alignment, and pointers for list management. It ensures that the page layout adheres
+ * to the specified alignment and padding requirements. It is constexpr, so a layout known at
+ * compile time (OALayout) is a constant.
+ * @param pointerSize Size of a pointer, used for page list link.
+ * @param leftAlignSize Size of left alignment padding.
+ * @param block_size Size of a single block, including object, header, and padding.
+ * @param objectsPerPage Number of objects per page.
+ * @param interAlignSize Size of alignment padding between objects.
+ * @return size_t The total size of a page in bytes.
+ */
+constexpr size_t ObjectAllocator::CalculateTotalPageSize(size_t pointerSize, size_t leftAlignSize, size_t block_size, size_t objectsPerPage,
+    size_t interAlignSize)
+{
+    size_t pageSize = pointerSize + leftAlignSize;
+    pageSize += block_size * objectsPerPage;
+    if (objectsPerPage > 1)
+    { //subtract inter-object alignment for the last object
+        pageSize -= interAlignSize;
+    }
+    return pageSize;
+}
+
+/**
+ * @brief Calculates the padding needed to satisfy the alignment requirement.
+ * This utility function computes how much padding is required to align the next block
+ * or structure according to the specified alignment. It is used to ensure that all objects
+ * and headers are correctly aligned in memory.
+ * @param size Current size before alignment.
+ * @param alignment Required alignment boundary.
+ * @return size_t The size of padding in bytes needed to achieve the alignment.
+ */
+constexpr size_t ObjectAllocator::CalculatePadding(size_t size, size_t alignment)
+{
+    size_t padding = alignment - (size % alignment);
+    return (padding == alignment) ? 0 : padding;
+}
+
+/*!
+  Where the blocks of a page go, worked out from sizes alone. Every member
+  function is constexpr, so with sizes known at compile time the layout is
+  a constant (BasicObjectAllocator, StaticObjectPool); ObjectAllocator makes
+  one from its OAConfig at construction.
+*/
+struct OALayout
+{
+  /*!
+    Constructor
+
+    \param ObjectSize
+      The size of each object.
+
+    \param ObjectsPerPage
+      Number of objects for each page of memory.
+
+    \param HeaderSize
+      The size of the header of each block.
+
+    \param PadBytes
+      The number of bytes to the left and right of a block.
+
+    \param Alignment
+      The number of bytes to align on (0 = none).
+
+    \param PageHeaderSize
+      The bytes after the page link left to the client.
+  */
+  constexpr OALayout(size_t ObjectSize, size_t ObjectsPerPage, size_t HeaderSize = 0, size_t PadBytes = 0,
+                     size_t Alignment = 0, size_t PageHeaderSize = 0)
+    : LeftAlignSize_(Alignment ? ObjectAllocator::CalculatePadding(sizeof(void*) + PageHeaderSize + HeaderSize + PadBytes, Alignment) : 0),
+      InterAlignSize_(Alignment ? ObjectAllocator::CalculatePadding(HeaderSize + 2 * PadBytes + ObjectSize, Alignment) : 0),
+      BlockStride_(HeaderSize + 2 * PadBytes + ObjectSize + InterAlignSize_),
+      FirstBlockOffset_(sizeof(void*) + PageHeaderSize + LeftAlignSize_ + HeaderSize + PadBytes),
+      PageSize_(ObjectAllocator::CalculateTotalPageSize(sizeof(void*) + PageHeaderSize, LeftAlignSize_, BlockStride_,
+                                                        ObjectsPerPage, InterAlignSize_))
+  {}
+
+  size_t LeftAlignSize_;    //!< alignment bytes before the first block
+  size_t InterAlignSize_;   //!< alignment bytes between two blocks
+  size_t BlockStride_;      //!< distance between the starts of two neighbouring blocks
+  size_t FirstBlockOffset_; //!< offset of the first object from the start of the page
+  size_t PageSize_;         //!< bytes from the start of the page to the end of its last block
 };
 
 #endif
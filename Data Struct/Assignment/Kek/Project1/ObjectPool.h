@@ -0,0 +1,274 @@
+/*!************************************************************************
+\file   ObjectPool.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Typed pool over ObjectAllocator: objects are constructed in place in the
+  allocator's blocks and destroyed before their blocks go back, and a
+  unique_ptr handle returns an object to its pool when it goes out of scope.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef OBJECTPOOLH
+#define OBJECTPOOLH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*!
+  Page alignment of the pools of objects of ObjectSize bytes: 64 KB, or
+  more so that a page holds at least 16 objects
+*/
+constexpr size_t ObjectPoolPageAlignment(size_t ObjectSize)
+{
+    size_t alignment = 64 * 1024;
+    while (alignment < 16 * ObjectSize)
+    {
+        alignment <<= 1;
+    }
+    return alignment;
+}
+
+/*!
+  Pool of objects of type T.
+
+  emplace constructs a T in a block from the allocator, forwarding its
+  arguments straight to the constructor, and destroy runs the destructor
+  before the block is freed, so move-only types work and nothing is copied.
+  make does the same as emplace but returns a Handle, a std::unique_ptr
+  whose deleter holds nothing: it is the size of a T*.
+
+  The deleter finds the pool from the object itself. Every page is aligned
+  on PAGE_ALIGNMENT, which depends only on T, and keeps a pointer to its
+  pool in its page header, so the pool of any object is one mask and one
+  load away. For that the pool fills each page: ObjectsPerPage_ is replaced
+  by as many objects as fit in PAGE_ALIGNMENT bytes, and MaxPages_ counts
+  those pages.
+
+  sizeof(T) sets the object size and alignof(T) the Alignment_ (combined
+  with the one in the configuration). The other settings, debugging
+  included, are the configuration's. UseCPPMemManager_ is ignored, as an
+  object on no page has no pool to find.
+
+  Like ObjectAllocator it is not thread-safe. It can't be copied or moved,
+  as its pages point at it, and it must outlive every Handle it made.
+  Objects still alive when the pool is destroyed are not destroyed.
+*/
+template <typename T>
+class ObjectPool
+{
+  static_assert(!std::is_array<T>::value, "pool the element type, not the array");
+
+public:
+    static const size_t OBJECT_SIZE = sizeof(T) < sizeof(GenericObject) ? sizeof(GenericObject) : sizeof(T); //!< block size asked of the allocator
+    static const size_t PAGE_ALIGNMENT = ObjectPoolPageAlignment(OBJECT_SIZE);                               //!< every page is aligned on (and fills) this many bytes
+
+    /*!
+      Destroys an object and frees its block in whichever pool made it
+    */
+    struct Deleter
+    {
+        /*!
+          Returns the object to its pool
+
+          \param object
+            An object from make (or emplace).
+        */
+        void operator()(T* object) const
+        {
+            owner(object)->destroy(object);
+        }
+    };
+
+    typedef std::unique_ptr<T, Deleter> Handle; //!< owns one object of a pool
+
+    /*!
+      Creates the pool and its first page
+
+      \param config
+        Settings for the ObjectAllocator (see the class notes for what the
+        pool changes).
+
+      \throw OAException
+        E_NO_MEMORY when there is no memory for the first page, or when two
+        objects with their headers and pads don't fit in PAGE_ALIGNMENT bytes
+        (or the OS pages can't be made to fill exactly that).
+    */
+    explicit ObjectPool(const OAConfig& config = OAConfig(false, 0, 0))
+        : Allocator_(OBJECT_SIZE, Configure(config)), Misaligned_(false)
+    {
+        Allocator_.SetPageCallback(PageChanged, this);
+        if (Misaligned_)
+        {
+            throw OAException(OAException::E_NO_MEMORY, "ObjectPool: pages don't fill PAGE_ALIGNMENT bytes.");
+        }
+    }
+
+    /*!
+      Constructs an object in a block of the pool
+
+      \param args
+        Arguments forwarded to T's constructor.
+
+      \return
+        The object.
+
+      \throw OAException
+        When no block can be allocated. Anything T's constructor throws is
+        rethrown after the block is freed.
+    */
+    template <typename... Args>
+    T* emplace(Args&&... args)
+    {
+        void* block = Allocator_.Allocate();
+        try
+        {
+            return ::new (block) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            Allocator_.Free(block);
+            throw;
+        }
+    }
+
+    /*!
+      Constructs an object in a block of the pool and hands it to a Handle
+
+      \param args
+        Arguments forwarded to T's constructor.
+
+      \return
+        The handle that owns the object.
+
+      \throw OAException
+        As emplace.
+    */
+    template <typename... Args>
+    Handle make(Args&&... args)
+    {
+        return Handle(emplace(std::forward<Args>(args)...));
+    }
+
+    /*!
+      Destroys an object and frees its block
+
+      \param object
+        An object from emplace (nullptr is ignored).
+
+      \throw OAException
+        When the allocator rejects the block (debug configurations).
+    */
+    void destroy(T* object)
+    {
+        if (!object)
+        {
+            return;
+        }
+        object->~T();
+        Allocator_.Free(object);
+    }
+
+    /*!
+      Finds the pool an object came from, in the header of the object's page
+
+      \param object
+        An object from any ObjectPool<T>.
+
+      \return
+        Its pool.
+    */
+    static ObjectPool* owner(const T* object)
+    {
+        uintptr_t page = reinterpret_cast<uintptr_t>(object) & ~(static_cast<uintptr_t>(PAGE_ALIGNMENT) - 1);
+        return *reinterpret_cast<ObjectPool**>(page + sizeof(GenericObject*));
+    }
+
+    unsigned FreeEmptyPages() { return Allocator_.FreeEmptyPages(); } //!< releases the pages with no objects
+    const ObjectAllocator& allocator() const { return Allocator_; }    //!< the blocks' allocator (statistics, dumps, validation)
+
+      // Prevent copy construction and assignment
+    ObjectPool(const ObjectPool &pool) = delete;            //!< Do not implement!
+    ObjectPool &operator=(const ObjectPool &pool) = delete; //!< Do not implement!
+
+private:
+    /*!
+      Works out the allocator's configuration: aligned pages that fill
+      PAGE_ALIGNMENT bytes, a page header for the pool and T's alignment
+
+      \param config
+        The client's configuration.
+
+      \return
+        The configuration to use.
+    */
+    static OAConfig Configure(const OAConfig& config)
+    {
+        OAConfig result(config);
+        result.UseCPPMemManager_ = false;
+        result.AlignPages_ = true;
+        if (result.PageHeaderSize_ < sizeof(ObjectPool*))
+        {
+            result.PageHeaderSize_ = sizeof(ObjectPool*);
+        }
+
+        // Both alignments hold at the least common multiple
+        unsigned alignment = result.Alignment_ ? result.Alignment_ : static_cast<unsigned>(alignof(T));
+        while (alignment % alignof(T) != 0)
+        {
+            alignment += result.Alignment_;
+        }
+        result.Alignment_ = alignment > 1 ? alignment : 0;
+
+        // Past one object (whose page keeps its trailing alignment bytes) the page
+        // grows by one block stride per object; ask allocators that make no pages
+        // for the sizes of pages of two and three objects
+        OAConfig probe(result);
+        probe.UseCPPMemManager_ = true;
+        probe.OSPages_ = false;
+        probe.HugePages_ = false;
+        probe.ObjectsPerPage_ = 2;
+        size_t two = ObjectAllocator(OBJECT_SIZE, probe).GetStats().PageSize_;
+        probe.ObjectsPerPage_ = 3;
+        size_t stride = ObjectAllocator(OBJECT_SIZE, probe).GetStats().PageSize_ - two;
+        if (two > PAGE_ALIGNMENT)
+        {
+            throw OAException(OAException::E_NO_MEMORY, "ObjectPool: two objects don't fit on a page.");
+        }
+        result.ObjectsPerPage_ = static_cast<unsigned>(2 + (PAGE_ALIGNMENT - two) / stride);
+        return result;
+    }
+
+    /*!
+      Records the pool in the header of every new page, and checks the page
+      is as big as PAGE_ALIGNMENT (pages are aligned on their size)
+    */
+    static void PageChanged(const void* page, size_t size, bool added, void* context)
+    {
+        ObjectPool* pool = static_cast<ObjectPool*>(context);
+        if (added)
+        {
+            char* header = static_cast<char*>(const_cast<void*>(page)) + sizeof(GenericObject*);
+            *reinterpret_cast<ObjectPool**>(header) = pool;
+            if (size != PAGE_ALIGNMENT)
+            {
+                pool->Misaligned_ = true;
+            }
+        }
+    }
+
+    ObjectAllocator Allocator_; //!< supplies the blocks
+    bool Misaligned_;           //!< a page was not PAGE_ALIGNMENT bytes (the constructor fails)
+};
+
+#endif
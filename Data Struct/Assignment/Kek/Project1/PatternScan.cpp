@@ -0,0 +1,308 @@
+///*!************************************************************************
+//\file   PatternScan.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "PatternScan.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PATTERNSCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PATTERNSCAN_TARGET(isa)
+#else
+#define PATTERNSCAN_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+    typedef bool (*MATCHFN)(const unsigned char*, size_t, unsigned char);
+
+    /*!
+      One byte at a time
+    */
+    bool MatchBytes(const unsigned char* memory, size_t count, unsigned char pattern)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (memory[i] != pattern)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*!
+      8 bytes at a time, a last word overlapping the one before it for the odd bytes
+    */
+    bool MatchWords(const unsigned char* memory, size_t count, unsigned char pattern)
+    {
+        if (count < sizeof(uint64_t))
+        {
+            return MatchBytes(memory, count, pattern);
+        }
+
+        const uint64_t wide = pattern * 0x0101010101010101ULL;
+        uint64_t differ = 0;
+        uint64_t word;
+        for (size_t i = 0; i + sizeof(word) <= count; i += sizeof(word))
+        {
+            std::memcpy(&word, memory + i, sizeof(word));
+            differ |= word ^ wide;
+        }
+        if (count % sizeof(word))
+        {
+            std::memcpy(&word, memory + count - sizeof(word), sizeof(word));
+            differ |= word ^ wide;
+        }
+        return differ == 0;
+    }
+
+#ifdef PATTERNSCAN_X86
+    /*!
+      16 bytes at a time, a last vector overlapping the one before it for the odd bytes
+    */
+    PATTERNSCAN_TARGET("sse2")
+    bool MatchSSE2(const unsigned char* memory, size_t count, unsigned char pattern)
+    {
+        if (count < 16)
+        {
+            return MatchWords(memory, count, pattern);
+        }
+
+        const __m128i wide = _mm_set1_epi8(static_cast<char>(pattern));
+        __m128i differ = _mm_setzero_si128();
+        for (size_t i = 0; i + 16 <= count; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(memory + i));
+            differ = _mm_or_si128(differ, _mm_xor_si128(bytes, wide));
+        }
+        if (count % 16)
+        {
+            __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(memory + count - 16));
+            differ = _mm_or_si128(differ, _mm_xor_si128(last, wide));
+        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(differ, _mm_setzero_si128())) == 0xFFFF;
+    }
+
+    /*!
+      32 bytes at a time, a last vector overlapping the one before it for the odd bytes
+    */
+    PATTERNSCAN_TARGET("avx2")
+    bool MatchAVX2(const unsigned char* memory, size_t count, unsigned char pattern)
+    {
+        if (count < 32)
+        {
+            return MatchSSE2(memory, count, pattern);
+        }
+
+        const __m256i wide = _mm256_set1_epi8(static_cast<char>(pattern));
+        __m256i differ = _mm256_setzero_si256();
+        for (size_t i = 0; i + 32 <= count; i += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(memory + i));
+            differ = _mm256_or_si256(differ, _mm256_xor_si256(bytes, wide));
+        }
+        if (count % 32)
+        {
+            __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(memory + count - 32));
+            differ = _mm256_or_si256(differ, _mm256_xor_si256(last, wide));
+        }
+        return _mm256_testz_si256(differ, differ) != 0;
+    }
+
+    /*!
+      Does the CPU have SSE2?
+    */
+    bool HasSSE2()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        return true;
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+#else
+        return __builtin_cpu_supports("sse2") != 0;
+#endif
+    }
+
+    /*!
+      Does the CPU have AVX2, and does the OS save the YMM registers?
+    */
+    bool HasAVX2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        const int osxsave = 1 << 27;
+        const int avx = 1 << 28;
+        if ((info[2] & (osxsave | avx)) != (osxsave | avx) || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+
+    std::atomic<MATCHFN> ActiveKernel{ nullptr }; //!< what Matches calls, null until picked
+    std::atomic<int> ActiveType{ 0 };             //!< the KERNEL_TYPE of ActiveKernel
+}
+
+/**
+ * @brief Checks that a run of memory is one repeated byte.
+ * The kernel is picked on the first call. Kernels read the run in whole words or
+ * vectors and finish with one that overlaps the previous, so they never read past it.
+ * @param Memory The start of the run.
+ * @param Count The length of the run in bytes.
+ * @param Pattern The byte every one of them should be.
+ * @return bool True if every byte matches (or Count is 0); otherwise, false.
+ */
+bool PatternScan::Matches(const void* Memory, size_t Count, unsigned char Pattern)
+{
+    MATCHFN kernel = ActiveKernel.load(std::memory_order_relaxed);
+    if (!kernel)
+    {
+        Use(Best());
+        kernel = ActiveKernel.load(std::memory_order_relaxed);
+    }
+    return kernel(static_cast<const unsigned char*>(Memory), Count, Pattern);
+}
+
+/**
+ * @brief Pins the kernel Matches uses.
+ * @param Kernel The kernel wanted; the best supported one is used if the CPU lacks it.
+ */
+void PatternScan::Use(KERNEL_TYPE Kernel)
+{
+    if (!Supported(Kernel))
+    {
+        Kernel = Best();
+    }
+
+    MATCHFN kernel = MatchBytes;
+    switch (Kernel)
+    {
+    case kerBytes:
+        kernel = MatchBytes;
+        break;
+    case kerWords:
+        kernel = MatchWords;
+        break;
+#ifdef PATTERNSCAN_X86
+    case kerSSE2:
+        kernel = MatchSSE2;
+        break;
+    case kerAVX2:
+        kernel = MatchAVX2;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    ActiveType.store(static_cast<int>(Kernel), std::memory_order_relaxed);
+    ActiveKernel.store(kernel, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the widest kernel the CPU supports.
+ * @return KERNEL_TYPE The kernel.
+ */
+PatternScan::KERNEL_TYPE PatternScan::Best()
+{
+    if (Supported(kerAVX2))
+    {
+        return kerAVX2;
+    }
+    if (Supported(kerSSE2))
+    {
+        return kerSSE2;
+    }
+    return kerWords;
+}
+
+/**
+ * @brief Gets the kernel Matches uses now, picking it if no call has yet.
+ * @return KERNEL_TYPE The kernel.
+ */
+PatternScan::KERNEL_TYPE PatternScan::Current()
+{
+    if (!ActiveKernel.load(std::memory_order_relaxed))
+    {
+        Use(Best());
+    }
+    return static_cast<KERNEL_TYPE>(ActiveType.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Checks whether the CPU can run a kernel.
+ * The CPU is asked once; the answers are kept.
+ * @param Kernel The kernel.
+ * @return bool True if it can; otherwise, false.
+ */
+bool PatternScan::Supported(KERNEL_TYPE Kernel)
+{
+    switch (Kernel)
+    {
+    case kerBytes:
+    case kerWords:
+        return true;
+#ifdef PATTERNSCAN_X86
+    case kerSSE2:
+    {
+        static const bool sse2 = HasSSE2();
+        return sse2;
+    }
+    case kerAVX2:
+    {
+        static const bool avx2 = HasSSE2() && HasAVX2();
+        return avx2;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Gets a kernel's name, for reports.
+ * @param Kernel The kernel.
+ * @return const char* "bytes", "words", "sse2" or "avx2".
+ */
+const char* PatternScan::Name(KERNEL_TYPE Kernel)
+{
+    switch (Kernel)
+    {
+    case kerBytes:
+        return "bytes";
+    case kerWords:
+        return "words";
+    case kerSSE2:
+        return "sse2";
+    case kerAVX2:
+        return "avx2";
+    }
+    return "?";
+}
@@ -0,0 +1,57 @@
+/*!************************************************************************
+\file   PatternScan.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Checks that a run of memory is one repeated byte (pad bytes, freed and
+  unallocated patterns) a whole vector at a time, with the widest kernel
+  the CPU supports picked at run time.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef PATTERNSCANH
+#define PATTERNSCANH
+//---------------------------------------------------------------------------
+
+#include <cstddef>
+
+/*!
+  Pattern checking kernels behind one dispatch point.
+
+  Every kernel answers the same question and gives the same answer; they
+  differ only in how many bytes they compare at once. The first call picks
+  the widest kernel the CPU (and OS) supports: AVX2, then SSE2 on x86, and
+  8 bytes at a time everywhere else. Use lets a benchmark or a test pin a
+  kernel; asking for one the CPU lacks falls back to the best it has.
+*/
+class PatternScan
+{
+public:
+    /*!
+      The kernels, narrowest first
+    */
+    enum KERNEL_TYPE
+    {
+        kerBytes, //!< one byte at a time (the original loops)
+        kerWords, //!< 8 bytes at a time in a general register
+        kerSSE2,  //!< 16 bytes at a time (x86 only)
+        kerAVX2   //!< 32 bytes at a time (x86 with AVX2 only)
+    };
+
+    // True when each of the Count bytes at Memory equals Pattern (true for Count 0)
+    static bool Matches(const void* Memory, size_t Count, unsigned char Pattern);
+
+    // Makes Matches use Kernel, or the best supported kernel if the CPU lacks it
+    static void Use(KERNEL_TYPE Kernel);
+
+    static KERNEL_TYPE Best();                   // widest kernel the CPU supports
+    static KERNEL_TYPE Current();                // kernel Matches uses now
+    static bool Supported(KERNEL_TYPE Kernel);   // can the CPU run Kernel?
+    static const char* Name(KERNEL_TYPE Kernel); // "bytes", "words", "sse2" or "avx2"
+};
+
+#endif
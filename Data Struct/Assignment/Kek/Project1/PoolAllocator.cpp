@@ -0,0 +1,207 @@
+///*!************************************************************************
+//\file   PoolAllocator.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "PoolAllocator.h"
+
+/**
+ * @brief Constructs a PoolResource.
+ * No pool exists until the first block of its shape is allocated.
+ * @param Config Configuration used for every pool; its alignment is replaced by each pool's own.
+ */
+PoolResource::PoolResource(const OAConfig& Config)
+    : Config_{ Config }, Checked_{ Config.DebugOn_ || Config.UseCPPMemManager_ }, LastKey_{ 0 }, LastPool_{ nullptr }
+{
+}
+
+/**
+ * @brief Destructor for the PoolResource.
+ * Destroys every pool, which releases all of their pages.
+ */
+PoolResource::~PoolResource()
+{
+    for (auto& pool : Pools_)
+    {
+        delete pool.second.Pages;
+    }
+}
+
+/**
+ * @brief Allocates one block from the pool for its shape.
+ * The pool's own free list is popped; when it is empty the ObjectAllocator makes a
+ * page and its whole chain of blocks becomes the free list.
+ * @param size The size of the block.
+ * @param alignment The alignment the block needs (at most MAX_POOL_ALIGNMENT).
+ * @return void* The block.
+ * @throw std::bad_alloc If the pool can't be created or can't grow, as containers expect.
+ */
+void* PoolResource::Allocate(size_t size, size_t alignment)
+{
+    Pool* pool = PoolFor(size, alignment);
+
+    if (Checked_)
+    {
+        try
+        {
+            return pool->Pages->Allocate();
+        }
+        catch (const OAException&)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    if (!pool->FreeList)
+    {
+        if (Config_.MaxPages_ > 0 && pool->Pages->GetStats().PagesInUse_ >= Config_.MaxPages_)
+        {
+            throw std::bad_alloc();
+        }
+
+        GenericObject* tail = nullptr;
+        try
+        {
+            pool->FreeList = pool->Pages->CreatePage(tail);
+        }
+        catch (const OAException&)
+        {
+            throw std::bad_alloc();
+        }
+        if (!pool->FreeList)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    GenericObject* block = pool->FreeList;
+    pool->FreeList = block->Next;
+    ++pool->InUse;
+    return block;
+}
+
+/**
+ * @brief Returns a block to the pool it came from.
+ * @param block The block (nullptr is ignored).
+ * @param size The size it was allocated with.
+ * @param alignment The alignment it was allocated with.
+ * @throw OAException Throws an exception if the pool rejects the block (DebugOn_ only).
+ */
+void PoolResource::Free(void* block, size_t size, size_t alignment)
+{
+    if (!block)
+    {
+        return;
+    }
+
+    Pool* pool = PoolFor(size, alignment);
+    if (Checked_)
+    {
+        pool->Pages->Free(block);
+        return;
+    }
+
+    GenericObject* object = static_cast<GenericObject*>(block);
+    object->Next = pool->FreeList;
+    pool->FreeList = object;
+    --pool->InUse;
+}
+
+/**
+ * @brief Finds the pool for a block shape, creating it on first use.
+ * Blocks are at least a pointer in size so the free list fits. Pages from new are
+ * aligned for any fundamental type, so aligning blocks within the page is enough.
+ * Containers ask for one node type over and over, so the last pool is remembered.
+ * The first page's blocks are taken over from the ObjectAllocator right away.
+ * @param size The size of the blocks.
+ * @param alignment The alignment of the blocks.
+ * @return Pool* The pool.
+ * @throw std::bad_alloc If the pool can't be created.
+ */
+PoolResource::Pool* PoolResource::PoolFor(size_t size, size_t alignment)
+{
+    size_t key = Key(size, alignment);
+    if (LastPool_ && key == LastKey_)
+    {
+        return LastPool_;
+    }
+
+    auto found = Pools_.find(key);
+    if (found == Pools_.end())
+    {
+        OAConfig config = Config_;
+        config.Alignment_ = alignment > 1 ? static_cast<unsigned>(alignment) : 0;
+
+        Pool pool = { nullptr, nullptr, 0 };
+        try
+        {
+            pool.Pages = new ObjectAllocator(size < sizeof(void*) ? sizeof(void*) : size, config);
+            found = Pools_.emplace(key, pool).first;
+        }
+        catch (...)
+        {
+            delete pool.Pages;
+            throw std::bad_alloc();
+        }
+
+        if (!Checked_)
+        {
+            found->second.FreeList = found->second.Pages->TakeFreeList();
+        }
+    }
+
+    LastKey_ = key;
+    LastPool_ = &found->second;
+    return LastPool_;
+}
+
+/**
+ * @brief Packs a block shape into a pool key.
+ * @param size The size of the blocks.
+ * @param alignment The alignment of the blocks (below 32).
+ * @return size_t The key.
+ */
+size_t PoolResource::Key(size_t size, size_t alignment)
+{
+    return (size << 5) | alignment;
+}
+
+/**
+ * @brief Gets the number of pools created so far.
+ * @return size_t The number of distinct block shapes seen.
+ */
+size_t PoolResource::PoolCount() const
+{
+    return Pools_.size();
+}
+
+/**
+ * @brief Gets the statistics of one pool.
+ * When the resource keeps the free blocks, the block counts are its own and the
+ * sizes and pages come from the ObjectAllocator.
+ * @param size The size of the blocks.
+ * @param alignment The alignment of the blocks.
+ * @return OAStats The pool's statistics, all zero if no such pool was created.
+ */
+OAStats PoolResource::GetStats(size_t size, size_t alignment) const
+{
+    auto found = Pools_.find(Key(size, alignment));
+    if (found == Pools_.end())
+    {
+        return OAStats();
+    }
+
+    OAStats stats = found->second.Pages->GetStats();
+    if (!Checked_)
+    {
+        stats.ObjectsInUse_ = found->second.InUse;
+        stats.FreeObjects_ = found->second.Pages->Capacity() - found->second.InUse;
+    }
+    return stats;
+}
@@ -0,0 +1,238 @@
+/*!************************************************************************
+\file   PoolAllocator.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Standard allocator adapter so node-based containers (std::list, std::map,
+  std::set, std::unordered_map nodes) take their nodes from ObjectAllocator
+  pools instead of the global heap.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef POOLALLOCATORH
+#define POOLALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+
+/*!
+  Owns one ObjectAllocator per (size, alignment), created the first time a
+  block of that shape is asked for. Every container whose allocator points
+  at the same resource shares its pools, so a std::map's nodes all come off
+  the same few pages.
+
+  Without DebugOn_ the ObjectAllocators only supply pages and the resource
+  keeps the free blocks itself, so a node costs a pointer pop/push. With
+  DebugOn_ every block goes through ObjectAllocator::Allocate/Free and gets
+  all of its checks.
+
+  Like ObjectAllocator it is not thread-safe, and it must outlive every
+  container that uses it.
+*/
+class PoolResource
+{
+public:
+    static const size_t MAX_POOL_ALIGNMENT = 16; //!< more strictly aligned types use the system heap
+
+    // Creates no pools yet; Config is used for each pool (Alignment_ is set per pool)
+    explicit PoolResource(const OAConfig& Config = OAConfig(false, 256, 0));
+
+    // Destroys every pool (never throws)
+    ~PoolResource();
+
+    // Takes one block of size bytes aligned on alignment from its pool
+    // Throws std::bad_alloc when the pool can't grow.
+    void* Allocate(size_t size, size_t alignment);
+
+    // Returns a block from Allocate with the same size and alignment
+    // Throws an OAException if the pool rejects the block (debug configurations).
+    void Free(void* block, size_t size, size_t alignment);
+
+    size_t PoolCount() const;                              // number of pools created so far
+    OAStats GetStats(size_t size, size_t alignment) const; // statistics of one pool (zero if it doesn't exist)
+
+      // Prevent copy construction and assignment
+    PoolResource(const PoolResource &resource) = delete;            //!< Do not implement!
+    PoolResource &operator=(const PoolResource &resource) = delete; //!< Do not implement!
+
+private:
+    /*!
+      The blocks of one shape
+    */
+    struct Pool
+    {
+        ObjectAllocator* Pages;  //!< creates the pages (and does all the work with DebugOn_)
+        GenericObject* FreeList; //!< blocks not in use, when the resource keeps them
+        unsigned InUse;          //!< blocks handed out, when the resource keeps them
+    };
+
+    Pool* PoolFor(size_t size, size_t alignment);
+    static size_t Key(size_t size, size_t alignment);
+
+    OAConfig Config_;                        //!< configuration of every pool
+    bool Checked_;                           //!< every block goes through ObjectAllocator (DebugOn_)
+    std::unordered_map<size_t, Pool> Pools_; //!< pools by (size << 5) | alignment
+    size_t LastKey_;                         //!< key of the last lookup
+    Pool* LastPool_;                         //!< pool of the last lookup
+};
+
+/*!
+  Allocator for standard containers. allocate(1) takes a block from the
+  resource's pool for T; arrays (such as hash bucket tables) and over-aligned
+  types use the system heap: ::operator new, or for types aligned beyond
+  std::max_align_t the aligned operator new where the compiler has it
+  (__cpp_aligned_new) and _aligned_malloc/posix_memalign where it doesn't.
+
+  Rebound copies share the resource, and two allocators compare equal when
+  they share it, so memory from one can be freed through the other. The
+  allocator moves with the container on copy/move assignment and swap.
+  There is no default constructor: a container must be given its resource.
+*/
+template <typename T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;                                        //!< type of the objects allocated
+    typedef std::true_type propagate_on_container_copy_assignment; //!< the resource follows the contents
+    typedef std::true_type propagate_on_container_move_assignment; //!< moving never has to copy elements
+    typedef std::true_type propagate_on_container_swap;          //!< swapped containers keep freeing to the right pools
+    typedef std::false_type is_always_equal;                     //!< allocators of different resources differ
+
+    /*!
+      Allocator drawing from a resource
+
+      \param resource
+        The pools to use; must outlive every container using the allocator.
+    */
+    explicit PoolAllocator(PoolResource& resource) noexcept : Resource_(&resource) {}
+
+    /*!
+      Rebound copy, sharing the resource
+    */
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : Resource_(other.resource()) {}
+
+    /*!
+      Allocates room for count objects
+
+      \param count
+        Number of objects.
+
+      \return
+        Uninitialized storage.
+
+      \throw std::bad_alloc
+        When neither the pool nor the system heap has memory.
+    */
+    T* allocate(std::size_t count)
+    {
+        if (count == 1 && alignof(T) <= PoolResource::MAX_POOL_ALIGNMENT)
+        {
+            return static_cast<T*>(Resource_->Allocate(sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(HeapAllocate(count * sizeof(T)));
+    }
+
+    /*!
+      Releases storage from allocate
+
+      \param pointer
+        The storage.
+
+      \param count
+        The count it was allocated with.
+    */
+    void deallocate(T* pointer, std::size_t count)
+    {
+        if (count == 1 && alignof(T) <= PoolResource::MAX_POOL_ALIGNMENT)
+        {
+            Resource_->Free(pointer, sizeof(T), alignof(T));
+            return;
+        }
+        HeapFree(pointer);
+    }
+
+    PoolResource* resource() const noexcept { return Resource_; } //!< the pools this allocator uses
+
+private:
+    static const bool OVER_ALIGNED = alignof(T) > alignof(std::max_align_t); //!< plain ::operator new can't align T
+
+    /*!
+      Takes storage the pools don't provide from the system heap, aligned for T
+    */
+    static void* HeapAllocate(std::size_t bytes)
+    {
+        if (!OVER_ALIGNED)
+        {
+            return ::operator new(bytes);
+        }
+#if defined(__cpp_aligned_new)
+        return ::operator new(bytes, std::align_val_t(alignof(T)));
+#else
+        void* memory = nullptr;
+#ifdef _MSC_VER
+        memory = _aligned_malloc(bytes, alignof(T));
+#else
+        if (posix_memalign(&memory, alignof(T), bytes) != 0)
+        {
+            memory = nullptr;
+        }
+#endif
+        if (!memory)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+#endif
+    }
+
+    /*!
+      Releases storage from HeapAllocate
+    */
+    static void HeapFree(void* pointer)
+    {
+        if (!OVER_ALIGNED)
+        {
+            ::operator delete(pointer);
+            return;
+        }
+#if defined(__cpp_aligned_new)
+        ::operator delete(pointer, std::align_val_t(alignof(T)));
+#elif defined(_MSC_VER)
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+
+    PoolResource* Resource_; //!< the pools, never null
+};
+
+/*!
+  Allocators are equal when memory from one can be freed through the other
+*/
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) noexcept
+{
+    return lhs.resource() == rhs.resource();
+}
+
+/*!
+  Allocators are equal when memory from one can be freed through the other
+*/
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+#endif
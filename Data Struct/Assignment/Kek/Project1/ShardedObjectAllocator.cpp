@@ -0,0 +1,603 @@
+///*!************************************************************************
+//\file   ShardedObjectAllocator.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "ShardedObjectAllocator.h"
+#include <cstdint>
+#include <unordered_map>
+
+/*!
+  One thread's ObjectAllocator and the queue other threads free its blocks to.
+  The remote-free list is the only part written by other threads; it is kept
+  a cache line away from the fields the owner works with.
+*/
+struct ShardedObjectAllocator::Shard
+{
+    std::atomic<GenericObject*> RemoteFrees; //!< blocks freed by other threads, pushed with a CAS
+    char Separator[64];                      //!< keeps the owner's fields off the remote-free list's line
+    ShardedObjectAllocator* Owner;           //!< the allocator the shard belongs to
+    ObjectAllocator* Pages;                  //!< the shard's pages and blocks, touched only by the owning thread
+    GenericObject* Cache;                    //!< free blocks taken from Pages, when not checking
+    unsigned Cached;                         //!< blocks in Cache
+    std::vector<void*> Drained;              //!< blocks being handed back to Pages, reused between calls
+    std::atomic<unsigned> Allocations;       //!< requests served by this shard
+    std::atomic<unsigned> Deallocations;     //!< blocks this shard took back (its own and drained ones)
+    std::atomic<unsigned> PagesInUse;        //!< pages of this shard, for GetStats
+    bool Parked;                             //!< its thread has exited, the shard can be adopted
+};
+
+namespace
+{
+    //!< Guards LiveAllocators, taken only on construction, destruction and thread exit
+    std::mutex RegistryLock;
+    //!< Allocators that still exist, by id, so an exiting thread knows whose shards it may park
+    std::unordered_map<unsigned long long, ShardedObjectAllocator*> LiveAllocators;
+    //!< Source of allocator ids; ids are never reused, unlike addresses
+    std::atomic<unsigned long long> NextId{ 1 };
+
+    /*!
+      Single-writer increment for the per-shard counters
+    */
+    void Bump(std::atomic<unsigned>& counter, unsigned amount = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+}
+
+/*!
+  The calling thread's shards, one per allocator it has used. When the thread
+  exits, the shards of allocators that are still alive are parked for reuse.
+*/
+struct ShardedObjectAllocator::ShardList
+{
+    std::unordered_map<unsigned long long, Shard*> Shards; //!< by allocator id
+    unsigned long long LastId = 0;                         //!< allocator of the last lookup
+    Shard* LastShard = nullptr;                            //!< shard of the last lookup
+
+    /*!
+      Parks the shards of live allocators before the thread goes away
+    */
+    ~ShardList()
+    {
+        std::lock_guard<std::mutex> registryGuard(RegistryLock);
+        for (auto& entry : Shards)
+        {
+            auto live = LiveAllocators.find(entry.first);
+            if (live != LiveAllocators.end())
+            {
+                live->second->ReleaseShard(entry.second);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Constructs a ShardedObjectAllocator.
+ * Shards use aligned pages with a one-pointer page header, which is where a page
+ * records its shard. No shard or page exists until a thread allocates.
+ * @param ObjectSize The size of each object to be managed by the allocator.
+ * @param config Configuration settings for every shard's ObjectAllocator.
+ */
+ShardedObjectAllocator::ShardedObjectAllocator(size_t ObjectSize, const OAConfig& config)
+    : ObjectSize_{ ObjectSize }, PageSize_{ 0 }, Config_{ config }, Checked_{ config.DebugOn_ || config.UseCPPMemManager_ },
+      PageMask_{ 0 }, Id_{ NextId++ }, MostObjects_{ 0 }
+{
+    Config_.AlignPages_ = true;
+    if (Config_.PageHeaderSize_ < sizeof(Shard*))
+    {
+        Config_.PageHeaderSize_ = sizeof(Shard*);
+    }
+
+    std::lock_guard<std::mutex> registryGuard(RegistryLock);
+    LiveAllocators[Id_] = this;
+}
+
+/**
+ * @brief Destructor for the ShardedObjectAllocator.
+ * Unregisters the allocator first, so no exiting thread can reach it any more, then
+ * destroys every shard, which releases its pages. Blocks still queued are released
+ * with them.
+ */
+ShardedObjectAllocator::~ShardedObjectAllocator()
+{
+    {
+        std::lock_guard<std::mutex> registryGuard(RegistryLock);
+        LiveAllocators.erase(Id_);
+    }
+
+    for (Shard* shard : Shards_)
+    {
+        delete shard->Pages;
+        delete shard;
+    }
+}
+
+/**
+ * @brief Allocates a block from the calling thread's shard.
+ * Blocks other threads have freed to the shard are taken back first, so they are
+ * reused before the shard grows. The block comes off the shard's cache, which is
+ * refilled CACHE_BATCH blocks at a time, or straight from the ObjectAllocator
+ * when checking. Only creating the thread's shard, or noting a new peak when the
+ * shard grows, takes a lock.
+ * @param label Optional label for the block, passed on to the shard's ObjectAllocator.
+ * @return void* Pointer to the allocated block of memory.
+ * @throw OAException Throws an exception if the shard has reached its page limit,
+ *        the system is out of memory, or a drained remote free was invalid.
+ */
+void* ShardedObjectAllocator::Allocate(const char* label)
+{
+    Shard* shard = GetShard(true);
+
+    if (shard->RemoteFrees.load(std::memory_order_relaxed))
+    {
+        DrainRemoteFrees(shard);
+    }
+
+    unsigned pages = shard->PagesInUse.load(std::memory_order_relaxed);
+    void* block = nullptr;
+    if (Checked_)
+    {
+        block = shard->Pages->Allocate(label);
+    }
+    else
+    {
+        if (!shard->Cache)
+        {
+            Refill(shard);
+        }
+        block = shard->Cache;
+        shard->Cache = shard->Cache->Next;
+        --shard->Cached;
+    }
+    Bump(shard->Allocations);
+
+    if (shard->PagesInUse.load(std::memory_order_relaxed) != pages)
+    {
+        UpdateMostObjects();
+    }
+    return block;
+}
+
+/**
+ * @brief Frees a block from any thread.
+ * The block's page tells which shard owns it. The owner's own blocks go back to
+ * its cache or, when checking, straight to its ObjectAllocator; anybody else's
+ * are pushed onto the owner's
+ * remote-free list and wait there for the owner's next Allocate. A thread that
+ * only frees never gets a shard of its own.
+ * @param Object Pointer to the object to be freed.
+ * @throw OAException Throws an exception if the calling thread owns the block and
+ *        its ObjectAllocator rejects it.
+ */
+void ShardedObjectAllocator::Free(void* Object)
+{
+    if (!Object)
+    {
+        return;
+    }
+
+    if (Config_.UseCPPMemManager_)
+    {
+        //blocks came from new, any thread can return them, the count goes to the caller's shard
+        delete[] static_cast<char*>(Object);
+        Bump(GetShard(true)->Deallocations);
+        return;
+    }
+
+    Shard* owner = OwnerOf(Object);
+    if (owner == GetShard(false))
+    {
+        if (Checked_)
+        {
+            owner->Pages->Free(Object);
+        }
+        else
+        {
+            GenericObject* block = static_cast<GenericObject*>(Object);
+            block->Next = owner->Cache;
+            owner->Cache = block;
+            ++owner->Cached;
+        }
+        Bump(owner->Deallocations);
+        return;
+    }
+
+    GenericObject* block = static_cast<GenericObject*>(Object);
+    GenericObject* head = owner->RemoteFrees.load(std::memory_order_relaxed);
+    do
+    {
+        block->Next = head;
+    } while (!owner->RemoteFrees.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+/**
+ * @brief Frees the empty pages of the calling thread's shard and of parked shards.
+ * Each shard takes back its remote frees and empties its cache first, so pages
+ * whose blocks were all freed count as empty. Shards owned by other running threads
+ * are left alone; they can call this themselves.
+ * @return unsigned The number of pages that were freed.
+ * @throw OAException Throws an exception if a drained remote free was invalid.
+ */
+unsigned ShardedObjectAllocator::FreeEmptyPages()
+{
+    unsigned freed = 0;
+
+    Shard* own = GetShard(false);
+    if (own && !Config_.UseCPPMemManager_)
+    {
+        DrainRemoteFrees(own);
+        Flush(own);
+        freed += own->Pages->FreeEmptyPages();
+    }
+
+    std::lock_guard<std::mutex> shardGuard(ShardLock_);
+    for (Shard* shard : Shards_)
+    {
+        //a parked shard can only be adopted under ShardLock_, so it is safe to work on here
+        if (shard->Parked && !Config_.UseCPPMemManager_)
+        {
+            DrainRemoteFrees(shard);
+            Flush(shard);
+            freed += shard->Pages->FreeEmptyPages();
+        }
+    }
+    return freed;
+}
+
+/**
+ * @brief Gets the number of shards created so far.
+ * @return unsigned One per thread that has allocated at the same time as others.
+ */
+unsigned ShardedObjectAllocator::ShardCount() const
+{
+    std::lock_guard<std::mutex> shardGuard(ShardLock_);
+    return static_cast<unsigned>(Shards_.size());
+}
+
+/**
+ * @brief Retrieves the configuration every shard uses.
+ * @return OAConfig The configuration given to the constructor, with aligned pages
+ *         and room for the owner in the page header.
+ */
+OAConfig ShardedObjectAllocator::GetConfig() const
+{
+    return Config_;
+}
+
+/**
+ * @brief Gets the statistics of the allocator as a whole.
+ * The counters are summed over the shards. A block waiting on a remote-free list
+ * still counts as in use until its owner takes it back. MostObjects_ is sampled
+ * whenever a shard grows and here, so it can lag the true peak by up to a page
+ * per shard.
+ * @return OAStats A structure containing the allocator's statistics.
+ */
+OAStats ShardedObjectAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> shardGuard(ShardLock_);
+    OAStats stats;
+    stats.ObjectSize_ = ObjectSize_;
+    stats.PageSize_ = PageSize_;
+
+    for (const Shard* shard : Shards_)
+    {
+        stats.Allocations_ += shard->Allocations.load(std::memory_order_relaxed);
+        stats.Deallocations_ += shard->Deallocations.load(std::memory_order_relaxed);
+        stats.PagesInUse_ += shard->PagesInUse.load(std::memory_order_relaxed);
+    }
+    stats.ObjectsInUse_ = stats.Allocations_ - stats.Deallocations_;
+    if (!Config_.UseCPPMemManager_)
+    {
+        stats.FreeObjects_ = stats.PagesInUse_ * Config_.ObjectsPerPage_ - stats.ObjectsInUse_;
+    }
+
+    unsigned most = MostObjects_.load(std::memory_order_relaxed);
+    stats.MostObjects_ = stats.ObjectsInUse_ > most ? stats.ObjectsInUse_ : most;
+    return stats;
+}
+
+/**
+ * @brief Finds the calling thread's shard, optionally giving it one.
+ * The thread's last lookup is remembered, so the common case is one comparison.
+ * A new shard is an adopted parked shard when there is one, else a new
+ * ObjectAllocator whose pages are tagged with the shard as they are created.
+ * @param create True to give the thread a shard when it has none.
+ * @return Shard* The thread's shard, or nullptr if it has none and create is false.
+ * @throw OAException Throws an exception if a new shard can't create its first page.
+ */
+ShardedObjectAllocator::Shard* ShardedObjectAllocator::GetShard(bool create)
+{
+    thread_local ShardList list;
+    if (list.LastShard && list.LastId == Id_)
+    {
+        return list.LastShard;
+    }
+
+    Shard* shard = nullptr;
+    auto found = list.Shards.find(Id_);
+    if (found != list.Shards.end())
+    {
+        shard = found->second;
+    }
+    else if (!create)
+    {
+        return nullptr;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> shardGuard(ShardLock_);
+        for (Shard* parked : Shards_)
+        {
+            if (parked->Parked)
+            {
+                parked->Parked = false;
+                shard = parked;
+                break;
+            }
+        }
+
+        if (!shard)
+        {
+            shard = new Shard();
+            shard->RemoteFrees.store(nullptr, std::memory_order_relaxed);
+            shard->Owner = this;
+            shard->Pages = nullptr;
+            shard->Cache = nullptr;
+            shard->Cached = 0;
+            shard->Parked = false;
+            try
+            {
+                shard->Pages = new ObjectAllocator(ObjectSize_, Config_);
+                shard->Pages->SetPageCallback(PageChanged, shard);
+                Shards_.push_back(shard);
+            }
+            catch (const std::bad_alloc&)
+            {
+                delete shard->Pages;
+                delete shard;
+                throw OAException(OAException::E_NO_MEMORY, "Allocate: No system memory available.");
+            }
+            catch (const OAException&)
+            {
+                delete shard;
+                throw;
+            }
+            PageSize_ = shard->Pages->GetStats().PageSize_;
+        }
+        list.Shards[Id_] = shard;
+    }
+
+    list.LastId = Id_;
+    list.LastShard = shard;
+    return shard;
+}
+
+/**
+ * @brief Reads which shard owns a block from the header of the block's page.
+ * @param Object A block from Allocate.
+ * @return Shard* The shard that allocated it.
+ */
+ShardedObjectAllocator::Shard* ShardedObjectAllocator::OwnerOf(void* Object) const
+{
+    uintptr_t page = reinterpret_cast<uintptr_t>(Object) & PageMask_.load(std::memory_order_relaxed);
+    return *reinterpret_cast<Shard**>(page + sizeof(GenericObject*));
+}
+
+/**
+ * @brief Parks a shard whose thread is exiting, so another thread can adopt it.
+ * Its pages, blocks still in use and pending remote frees all stay with it.
+ * @param shard The exiting thread's shard.
+ */
+void ShardedObjectAllocator::ReleaseShard(Shard* shard)
+{
+    std::lock_guard<std::mutex> shardGuard(ShardLock_);
+    shard->Parked = true;
+}
+
+/**
+ * @brief Takes a shard's remote frees back.
+ * The whole list is taken with one exchange. Since only the owner ever takes
+ * from it, a block cannot be popped and pushed back under a pusher (no ABA).
+ * Without checking, the list is spliced onto the shard's cache as it is. When
+ * checking, the blocks are freed with one FreeBatch; if any is invalid, the valid
+ * ones are freed one at a time and the first error is thrown afterwards. A block
+ * freed twice by other threads is reported as a multiple free; the blocks pushed
+ * between its two frees are lost to the loop it made (all of the list, without
+ * checking, since none of it can be trusted).
+ * @param shard The shard, owned by the calling thread (or parked, under ShardLock_).
+ * @throw OAException Throws the exception of the first invalid block.
+ */
+void ShardedObjectAllocator::DrainRemoteFrees(Shard* shard)
+{
+    GenericObject* list = shard->RemoteFrees.exchange(nullptr, std::memory_order_acquire);
+    if (!list)
+    {
+        return;
+    }
+
+    //a block freed twice links the list into a loop; the valid blocks are at most the
+    //shard's blocks in use, so one more than that is sure to include the repeat
+    unsigned inUse = shard->Allocations.load(std::memory_order_relaxed) - shard->Deallocations.load(std::memory_order_relaxed);
+    if (!Checked_)
+    {
+        GenericObject* tail = list;
+        unsigned count = 1;
+        while (tail->Next && count <= inUse)
+        {
+            tail = tail->Next;
+            ++count;
+        }
+        if (count > inUse)
+        {
+            throw OAException(OAException::E_MULTIPLE_FREE, "Free: Object has already been freed.");
+        }
+
+        tail->Next = shard->Cache;
+        shard->Cache = list;
+        shard->Cached += count;
+        Bump(shard->Deallocations, count);
+        return;
+    }
+
+    shard->Drained.clear();
+    for (; list && shard->Drained.size() <= inUse; list = list->Next)
+    {
+        shard->Drained.push_back(list);
+    }
+
+    unsigned count = static_cast<unsigned>(shard->Drained.size());
+    try
+    {
+        shard->Pages->FreeBatch(shard->Drained.data(), count);
+        Bump(shard->Deallocations, count);
+    }
+    catch (const OAException& batchError)
+    {
+        OAException error = batchError;
+        unsigned freed = 0;
+        for (void* block : shard->Drained)
+        {
+            try
+            {
+                shard->Pages->Free(block);
+                ++freed;
+            }
+            catch (const OAException&)
+            {
+            }
+        }
+        Bump(shard->Deallocations, freed);
+        throw error;
+    }
+}
+
+/**
+ * @brief Fills an empty cache from the shard's ObjectAllocator.
+ * A whole batch is taken with AllocateBatch; near the page limit, as many blocks
+ * as are left are taken one at a time.
+ * @param shard The shard, owned by the calling thread.
+ * @throw OAException Throws an exception if not even one block can be allocated.
+ */
+void ShardedObjectAllocator::Refill(Shard* shard)
+{
+    void* blocks[CACHE_BATCH];
+    unsigned count = 0;
+    try
+    {
+        shard->Pages->AllocateBatch(CACHE_BATCH, blocks);
+        count = CACHE_BATCH;
+    }
+    catch (const OAException& exception)
+    {
+        if (exception.code() != OAException::E_NO_PAGES)
+        {
+            throw;
+        }
+    }
+    while (count < CACHE_BATCH)
+    {
+        try
+        {
+            blocks[count] = shard->Pages->Allocate();
+        }
+        catch (const OAException&)
+        {
+            if (count == 0)
+            {
+                throw;
+            }
+            break;
+        }
+        ++count;
+    }
+
+    //first block of the batch on top, as Allocate would have handed them out
+    for (unsigned i = count; i-- > 0;)
+    {
+        GenericObject* block = static_cast<GenericObject*>(blocks[i]);
+        block->Next = shard->Cache;
+        shard->Cache = block;
+    }
+    shard->Cached += count;
+}
+
+/**
+ * @brief Gives every cached block back to the shard's ObjectAllocator.
+ * The blocks go back with one FreeBatch, so their pages can become empty.
+ * @param shard The shard, owned by the calling thread (or parked, under ShardLock_).
+ */
+void ShardedObjectAllocator::Flush(Shard* shard)
+{
+    if (!shard->Cache)
+    {
+        return;
+    }
+
+    shard->Drained.clear();
+    while (shard->Cache)
+    {
+        shard->Drained.push_back(shard->Cache);
+        shard->Cache = shard->Cache->Next;
+        --shard->Cached;
+    }
+    shard->Pages->FreeBatch(shard->Drained.data(), static_cast<unsigned>(shard->Drained.size()));
+}
+
+/**
+ * @brief Counts the blocks in use over every shard.
+ * @return unsigned Allocations minus deallocations. ShardLock_ must be held.
+ */
+unsigned ShardedObjectAllocator::ObjectsInUse() const
+{
+    unsigned inUse = 0;
+    for (const Shard* shard : Shards_)
+    {
+        inUse += shard->Allocations.load(std::memory_order_relaxed) - shard->Deallocations.load(std::memory_order_relaxed);
+    }
+    return inUse;
+}
+
+/**
+ * @brief Raises MostObjects_ to the number of blocks in use now, if that is higher.
+ */
+void ShardedObjectAllocator::UpdateMostObjects()
+{
+    std::lock_guard<std::mutex> shardGuard(ShardLock_);
+    unsigned inUse = ObjectsInUse();
+    if (inUse > MostObjects_.load(std::memory_order_relaxed))
+    {
+        MostObjects_.store(inUse, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Page callback of every shard: tags new pages with their shard.
+ * The shard is written into the page header before any block of the page is
+ * handed out. The first page also tells the allocator the page footprint.
+ * @param page Start of the page.
+ * @param size Bytes reserved for the page (a power of two, pages are aligned).
+ * @param added True when the page was created, false when it is being released.
+ * @param context The shard.
+ */
+void ShardedObjectAllocator::PageChanged(const void* page, size_t size, bool added, void* context)
+{
+    Shard* shard = static_cast<Shard*>(context);
+    if (added)
+    {
+        char* header = static_cast<char*>(const_cast<void*>(page)) + sizeof(GenericObject*);
+        *reinterpret_cast<Shard**>(header) = shard;
+        shard->Owner->PageMask_.store(~(size - 1), std::memory_order_relaxed);
+        Bump(shard->PagesInUse);
+    }
+    else
+    {
+        shard->PagesInUse.store(shard->PagesInUse.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,107 @@
+/*!************************************************************************
+\file   ShardedObjectAllocator.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Thread-safe allocator made of shards, each an ObjectAllocator owned by one
+  thread. Blocks freed by another thread are queued on their owner's
+  lock-free remote-free list and handed back in bulk by the owner.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef SHARDEDOBJECTALLOCATORH
+#define SHARDEDOBJECTALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*!
+  Allocator for pipelines, where objects are made on one thread and freed on
+  another.
+
+  Every thread that allocates gets a shard of its own: an ObjectAllocator
+  that only that thread touches, so Allocate and a Free of one of its own
+  blocks take no lock. Each page records its shard in a page header (the
+  word after the page link), and pages are aligned, so the owner of any
+  block is read from its page with a mask and one load.
+
+  Without DebugOn_ a shard keeps a cache of free blocks in front of its
+  ObjectAllocator, filled with AllocateBatch. Like a MagazineAllocator
+  depot, it keeps what it is given until FreeEmptyPages hands it back.
+  With DebugOn_ every block goes through Allocate/Free and all of the
+  ObjectAllocator's checks run, on the owner's thread.
+
+  A Free of another shard's block pushes it onto that shard's remote-free
+  list with a CAS. The owner takes the whole list with one exchange at its
+  next Allocate and splices it onto its cache (or frees it with one
+  FreeBatch when checking), so blocks never migrate between shards and
+  remote frees never wait on the owner.
+
+  A shard outlives its thread: when a thread exits its shard is parked, and
+  the next thread that needs a shard adopts it with its pages and pending
+  remote frees. MaxPages_ applies to each shard.
+*/
+class ShardedObjectAllocator
+{
+public:
+    static const unsigned CACHE_BATCH = 64; //!< blocks a shard takes from its ObjectAllocator at once
+
+    // Remembers the configuration; shards are created by the threads that use them
+    ShardedObjectAllocator(size_t ObjectSize, const OAConfig& config);
+
+    // Destroys every shard and its pages (never throws)
+    ~ShardedObjectAllocator();
+
+    // Takes a block from the calling thread's shard, after taking back its remote frees
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void* Allocate(const char* label = 0);
+
+    // Frees a block into its own shard when the caller owns it, else queues it on the owner
+    // Throws an exception if the calling thread's shard rejects the block (invalid object)
+    void Free(void* Object);
+
+    // Takes back the remote frees of the calling thread's shard and of parked shards, then frees their empty pages
+    unsigned FreeEmptyPages();
+
+    unsigned ShardCount() const;      // number of shards created so far
+    OAConfig GetConfig() const;       // returns the configuration parameters of every shard
+    OAStats GetStats() const;         // returns the statistics summed over the shards
+
+      // Prevent copy construction and assignment
+    ShardedObjectAllocator(const ShardedObjectAllocator &oa) = delete;            //!< Do not implement!
+    ShardedObjectAllocator &operator=(const ShardedObjectAllocator &oa) = delete; //!< Do not implement!
+
+private:
+    struct Shard;
+    struct ShardList;
+    friend struct ShardList;
+
+    Shard* GetShard(bool create);
+    Shard* OwnerOf(void* Object) const;
+    void ReleaseShard(Shard* shard);
+    void DrainRemoteFrees(Shard* shard);
+    void Refill(Shard* shard);
+    void Flush(Shard* shard);
+    unsigned ObjectsInUse() const;
+    void UpdateMostObjects();
+    static void PageChanged(const void* page, size_t size, bool added, void* context);
+
+    size_t ObjectSize_;                      //!< size of each object
+    size_t PageSize_;                        //!< size of a page, known once the first shard exists
+    OAConfig Config_;                        //!< configuration of every shard (aligned pages with a header)
+    bool Checked_;                           //!< debugging or new/delete: every block goes through the ObjectAllocator
+    mutable std::mutex ShardLock_;           //!< guards Shards_ and the shards' Parked flags
+    std::vector<Shard*> Shards_;             //!< every shard created for this allocator
+    std::atomic<size_t> PageMask_;           //!< ~(page footprint - 1), known once the first page exists
+    unsigned long long Id_;                  //!< identifies this allocator in the threads' shard lists
+    std::atomic<unsigned> MostObjects_;      //!< most objects in use, sampled when a shard grows
+};
+
+#endif
@@ -0,0 +1,277 @@
+///*!************************************************************************
+//\file   SizeClassAllocator.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//**************************************************************************/
+#include "SizeClassAllocator.h"
+#include <new>
+
+/**
+ * @brief Constructs a SizeClassAllocator.
+ * Builds the class table (powers of two with a step halfway between each from 32 on)
+ * and the request size to class lookup table, and checks that every class's page
+ * layout rounds up to PAGE_FOOTPRINT. The pools themselves are made on the first
+ * request for their class (see ClassConfig), so classes that are never used cost
+ * no pages.
+ * @throw OAException Throws an exception if a class's pages wouldn't be PAGE_FOOTPRINT bytes.
+ */
+SizeClassAllocator::SizeClassAllocator()
+{
+    ClassSizes_.push_back(8);
+    ClassSizes_.push_back(16);
+    for (size_t size = 32; size <= MAX_CLASS_SIZE; size *= 2)
+    {
+        ClassSizes_.push_back(size);
+        if (size + size / 2 <= MAX_CLASS_SIZE)
+        {
+            ClassSizes_.push_back(size + size / 2);
+        }
+    }
+
+    ClassOf_.resize(MAX_CLASS_SIZE / 8 + 1);
+    unsigned char sizeClass = 0;
+    for (size_t step = 0; step < ClassOf_.size(); ++step)
+    {
+        while (ClassSizes_[sizeClass] < step * 8)
+        {
+            ++sizeClass;
+        }
+        ClassOf_[step] = sizeClass;
+    }
+
+    // every class's pages must round up to PAGE_FOOTPRINT, or Free's mask would miss them
+    Pools_.resize(ClassSizes_.size(), nullptr);
+    for (size_t i = 0; i < ClassSizes_.size(); ++i)
+    {
+        OAConfig config = ClassConfig(static_cast<unsigned>(i));
+        OALayout layout(ClassSizes_[i], config.ObjectsPerPage_, 0, 0, config.Alignment_);
+        if (layout.PageSize_ > PAGE_FOOTPRINT || layout.PageSize_ <= PAGE_FOOTPRINT / 2)
+        {
+            throw OAException(OAException::E_NO_MEMORY, "SizeClassAllocator: Class pages don't fit PAGE_FOOTPRINT.");
+        }
+        Contexts_.push_back(PoolContext{ this, static_cast<unsigned char>(i) });
+    }
+}
+
+/**
+ * @brief Destructor for the SizeClassAllocator.
+ * Destroys every pool that was made, which releases all of their pages, and the
+ * large blocks that were never freed.
+ */
+SizeClassAllocator::~SizeClassAllocator()
+{
+    for (ObjectAllocator* pool : Pools_)
+    {
+        if (pool)
+        {
+            pool->SetPageCallback(nullptr, nullptr);
+            delete pool;
+        }
+    }
+    for (void* block : Large_)
+    {
+        delete[] static_cast<char*>(block);
+    }
+}
+
+/**
+ * @brief Allocates a block of at least size bytes.
+ * The class comes from a table indexed by the size in 8-byte steps, so routing
+ * costs one load. The class's pool is made by the first request for it. Requests
+ * above MAX_CLASS_SIZE use operator new, and the block is recorded for Free.
+ * @param size The number of bytes requested (0 is treated as 1).
+ * @return void* Pointer to the allocated block of memory.
+ * @throw OAException Throws an exception if memory cannot be allocated.
+ */
+void* SizeClassAllocator::Allocate(size_t size)
+{
+    if (size > MAX_CLASS_SIZE)
+    {
+        char* block = nullptr;
+        try
+        {
+            block = new char[size];
+            Large_.insert(block);
+            return block;
+        }
+        catch (const std::bad_alloc&)
+        {
+            delete[] block;
+            throw OAException(OAException::E_NO_MEMORY, "Allocate: No system memory available.");
+        }
+    }
+
+    unsigned sizeClass = ClassOf_[(size + 7) / 8];
+    ObjectAllocator* pool = Pools_[sizeClass];
+    if (!pool)
+    {
+        pool = CreatePool(sizeClass);
+    }
+    return pool->Allocate();
+}
+
+/**
+ * @brief Frees a block returned by Allocate.
+ * The pointer is masked down to its page base and looked up in the page map; a
+ * hit names the pool. A miss must be one of the large blocks from the system
+ * heap; anything else (a foreign pointer, or one inside a large block) is
+ * rejected rather than handed to delete[].
+ * @param Object Pointer to the object to be freed.
+ * @throw OAException Throws an exception if the owning pool rejects the block, or
+ *        if the pointer is neither on a pool page nor a large block.
+ */
+void SizeClassAllocator::Free(void* Object)
+{
+    if (!Object)
+    {
+        return;
+    }
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(Object) & ~(static_cast<uintptr_t>(PAGE_FOOTPRINT) - 1);
+    auto page = PageClass_.find(base);
+    if (page != PageClass_.end())
+    {
+        Pools_[page->second]->Free(Object);
+        return;
+    }
+
+    auto large = Large_.find(Object);
+    if (large == Large_.end())
+    {
+        throw OAException(OAException::E_BAD_BOUNDARY, "Boundary: Object has bad boundary.");
+    }
+    Large_.erase(large);
+    delete[] static_cast<char*>(Object);
+}
+
+/**
+ * @brief Frees the empty pages of every pool.
+ * @return unsigned The number of pages that were freed.
+ */
+unsigned SizeClassAllocator::FreeEmptyPages()
+{
+    unsigned freed = 0;
+    for (ObjectAllocator* pool : Pools_)
+    {
+        if (pool)
+        {
+            freed += pool->FreeEmptyPages();
+        }
+    }
+    return freed;
+}
+
+/**
+ * @brief Gets the number of size classes.
+ * @return unsigned The number of classes (and pools).
+ */
+unsigned SizeClassAllocator::ClassCount() const
+{
+    return static_cast<unsigned>(ClassSizes_.size());
+}
+
+/**
+ * @brief Gets the block size of a size class.
+ * @param sizeClass Index of the class, below ClassCount().
+ * @return size_t The block size in bytes.
+ */
+size_t SizeClassAllocator::ClassSize(unsigned sizeClass) const
+{
+    return ClassSizes_[sizeClass];
+}
+
+/**
+ * @brief Gets the statistics of one class's pool.
+ * @param sizeClass Index of the class, below ClassCount().
+ * @return OAStats The pool's statistics (only ObjectSize_ is set while the class is unused).
+ */
+OAStats SizeClassAllocator::GetStats(unsigned sizeClass) const
+{
+    if (!Pools_[sizeClass])
+    {
+        OAStats stats;
+        stats.ObjectSize_ = ClassSizes_[sizeClass];
+        return stats;
+    }
+    return Pools_[sizeClass]->GetStats();
+}
+
+/**
+ * @brief Gets the number of blocks currently taken from the system heap.
+ * @return unsigned The number of large blocks in use.
+ */
+unsigned SizeClassAllocator::LargeInUse() const
+{
+    return static_cast<unsigned>(Large_.size());
+}
+
+/**
+ * @brief Works out the configuration of a class's pool.
+ * The pool uses aligned pages and gets as many objects per page as fit in
+ * PAGE_FOOTPRINT, which keeps every pool's page footprint the same so a single
+ * mask finds the page of any block.
+ * @param sizeClass Index of the class, below ClassCount().
+ * @return OAConfig The configuration for the pool's ObjectAllocator.
+ */
+OAConfig SizeClassAllocator::ClassConfig(unsigned sizeClass) const
+{
+    size_t size = ClassSizes_[sizeClass];
+    unsigned alignment = size >= 16 ? 16 : 8;
+
+    // first block starts after the page link, rounded up to the alignment
+    size_t firstBlock = alignment > sizeof(void*) ? alignment : sizeof(void*);
+    unsigned objectsPerPage = static_cast<unsigned>((PAGE_FOOTPRINT - firstBlock) / size);
+
+    OAConfig config(false, objectsPerPage, 0, false, 0, OAConfig::HeaderBlockInfo(), alignment);
+    config.AlignPages_ = true;
+    return config;
+}
+
+/**
+ * @brief Makes the pool of a class and hooks it up to the page map.
+ * @param sizeClass Index of the class, whose pool doesn't exist yet.
+ * @return ObjectAllocator* The new pool.
+ * @throw OAException Throws an exception if the pool's first page can't be made.
+ */
+ObjectAllocator* SizeClassAllocator::CreatePool(unsigned sizeClass)
+{
+    ObjectAllocator* pool = new ObjectAllocator(ClassSizes_[sizeClass], ClassConfig(sizeClass));
+    try
+    {
+        pool->SetPageCallback(PageChanged, &Contexts_[sizeClass]);
+    }
+    catch (...)
+    {
+        pool->SetPageCallback(nullptr, nullptr);
+        delete pool;
+        throw;
+    }
+    Pools_[sizeClass] = pool;
+    return pool;
+}
+
+/**
+ * @brief Keeps the page map in step with a pool's pages.
+ * @param page Base of the page that was added or released.
+ * @param size Bytes reserved for the page (PAGE_FOOTPRINT).
+ * @param added True when the page was added, false when it was released.
+ * @param context The pool's PoolContext.
+ */
+void SizeClassAllocator::PageChanged(const void* page, size_t, bool added, void* context)
+{
+    PoolContext* pool = static_cast<PoolContext*>(context);
+    if (added)
+    {
+        pool->Owner->PageClass_[reinterpret_cast<uintptr_t>(page)] = pool->SizeClass;
+    }
+    else
+    {
+        pool->Owner->PageClass_.erase(reinterpret_cast<uintptr_t>(page));
+    }
+}
@@ -0,0 +1,93 @@
+/*!************************************************************************
+\file   SizeClassAllocator.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  General purpose Allocate(size)/Free(ptr) built from a table of
+  ObjectAllocator pools, one per size class. Requests larger than the
+  biggest class go to the system heap.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef SIZECLASSALLOCATORH
+#define SIZECLASSALLOCATORH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*!
+  Routes each request to the pool of the smallest size class that fits.
+
+  Classes grow geometrically (8, 16, 32, 48, 64, 96, ... 3072, 4096), every
+  block of 16 bytes or more is 16-byte aligned. All pools use aligned pages of
+  the same PAGE_FOOTPRINT, so masking a pointer gives the base of its page and
+  one lookup in the page map gives its class; Free needs no size. Blocks
+  above MAX_CLASS_SIZE come from the system heap and are recorded, so Free
+  can tell them from pointers it never handed out.
+
+  Like ObjectAllocator, it is not thread-safe.
+*/
+class SizeClassAllocator
+{
+public:
+    static const size_t MAX_CLASS_SIZE = 4096;           //!< larger requests use the system heap
+    static const size_t PAGE_FOOTPRINT = 64 * 1024;      //!< bytes reserved for every pool page
+
+    // Sets up the size classes (each class's pool is made on its first request)
+    // Throws an exception if the construction fails. (Memory allocation problem)
+    SizeClassAllocator();
+
+    // Destroys every pool and the large blocks still allocated (never throws)
+    ~SizeClassAllocator();
+
+    // Takes a block of at least size bytes from its class's pool, or from the system heap
+    // Throws an exception if the object can't be allocated. (Memory allocation problem)
+    void* Allocate(size_t size);
+
+    // Returns a block from Allocate, finding its pool from the page it sits on
+    // Throws an exception if the pool rejects the block, or it isn't a block at all. (Invalid object)
+    void Free(void* Object);
+
+    // Frees the empty pages of every pool
+    unsigned FreeEmptyPages();
+
+    unsigned ClassCount() const;                  // number of size classes
+    size_t ClassSize(unsigned sizeClass) const;   // block size of a class
+    OAStats GetStats(unsigned sizeClass) const;   // statistics of one class's pool
+    unsigned LargeInUse() const;                  // blocks currently taken from the system heap
+
+      // Prevent copy construction and assignment
+    SizeClassAllocator(const SizeClassAllocator &sca) = delete;            //!< Do not implement!
+    SizeClassAllocator &operator=(const SizeClassAllocator &sca) = delete; //!< Do not implement!
+
+private:
+    /*!
+      Passed to PageChanged so the callback knows which allocator and class it is for
+    */
+    struct PoolContext
+    {
+        SizeClassAllocator* Owner; //!< the allocator whose page map is updated
+        unsigned char SizeClass;   //!< the pool's class
+    };
+
+    OAConfig ClassConfig(unsigned sizeClass) const;
+    ObjectAllocator* CreatePool(unsigned sizeClass);
+    static void PageChanged(const void* page, size_t size, bool added, void* context);
+
+    std::vector<size_t> ClassSizes_;                         //!< block size of each class, ascending
+    std::vector<unsigned char> ClassOf_;                     //!< class for each request size, in 8-byte steps
+    std::vector<ObjectAllocator*> Pools_;                    //!< one pool per class, null until the class is used
+    std::vector<PoolContext> Contexts_;                      //!< callback context of each pool
+    std::unordered_map<uintptr_t, unsigned char> PageClass_; //!< page base -> class, for every pool page
+    std::unordered_set<void*> Large_;                        //!< blocks taken from the system heap
+};
+
+#endif
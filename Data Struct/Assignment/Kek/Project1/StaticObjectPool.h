@@ -0,0 +1,202 @@
+/*!************************************************************************
+\file   StaticObjectPool.h
+\author Maojie Deng (2200840)
+\par    SIT email: 2200840@sit.singaporetech.edu.sg
+\par    DP email: maojie.deng@digipen.edu
+\par    Course: csd2183
+\par    Assignment 1
+\date   31-01-2023
+
+\brief
+  Fixed-capacity typed pool whose one page lives inside the pool object, laid
+  out at compile time: no heap allocation, no page set-up, and strides and
+  offsets that are constants in the generated code.
+**************************************************************************/
+//---------------------------------------------------------------------------
+#ifndef STATICOBJECTPOOLH
+#define STATICOBJECTPOOLH
+//---------------------------------------------------------------------------
+
+#include "ObjectAllocator.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*!
+  Pool of at most N objects of type T.
+
+  The page is an array member laid out as ObjectAllocator lays out a page of
+  N objects with no headers or pads, aligned for T; the layout is an
+  OALayout constant, so Allocate and Free compile down to a few instructions
+  with no loads of sizes. A static (or member) pool takes no memory from the
+  heap, and constructing one only sets its counters: blocks never handed out
+  are taken in address order, and only returned blocks go on the free list.
+
+  emplace and destroy work as in ObjectPool. Nothing is checked on Free, as
+  with ReleasePolicy; Owns tells whether a pointer is one of the blocks.
+  Like ObjectAllocator it is not thread-safe. Objects still alive when the
+  pool is destroyed are not destroyed.
+*/
+template <typename T, unsigned N>
+class StaticObjectPool
+{
+  static_assert(N > 0, "a pool needs room for at least one object");
+  static_assert(!std::is_array<T>::value, "pool the element type, not the array");
+
+public:
+    static const unsigned CAPACITY = N;                                                                          //!< most objects in use at once
+    static const size_t OBJECT_SIZE = sizeof(T) < sizeof(GenericObject) ? sizeof(GenericObject) : sizeof(T);      //!< bytes of each block's object
+    static const size_t ALIGNMENT = alignof(T) < alignof(GenericObject) ? alignof(GenericObject) : alignof(T);    //!< alignment of the page and its blocks
+    static const size_t BLOCK_STRIDE = OALayout(OBJECT_SIZE, N, 0, 0, ALIGNMENT).BlockStride_;                    //!< distance between two blocks
+    static const size_t FIRST_BLOCK_OFFSET = OALayout(OBJECT_SIZE, N, 0, 0, ALIGNMENT).FirstBlockOffset_;         //!< first object from the page start
+    static const size_t PAGE_SIZE = OALayout(OBJECT_SIZE, N, 0, 0, ALIGNMENT).PageSize_;                          //!< bytes of the page
+
+    /*!
+      Creates an empty pool; the page is not touched
+    */
+    StaticObjectPool() noexcept : FreeList_(nullptr), Fresh_(0), ObjectsInUse_(0), Allocations_(0), Deallocations_(0) {}
+
+    /*!
+      Takes a block: the last one freed, or else the first never handed out
+
+      \return
+        The block.
+
+      \throw OAException
+        E_NO_PAGES when all N blocks are in use.
+    */
+    void* Allocate()
+    {
+        void* block;
+        if (FreeList_)
+        {
+            block = FreeList_;
+            FreeList_ = FreeList_->Next;
+        }
+        else if (Fresh_ < N)
+        {
+            block = Page_ + FIRST_BLOCK_OFFSET + Fresh_ * BLOCK_STRIDE;
+            ++Fresh_;
+        }
+        else
+        {
+            throw OAException(OAException::E_NO_PAGES, "StaticObjectPool: all of the pool's objects are in use.");
+        }
+
+        ++ObjectsInUse_;
+        ++Allocations_;
+        return block;
+    }
+
+    /*!
+      Returns a block from Allocate (it is not checked)
+
+      \param Object
+        The block.
+    */
+    void Free(void* Object)
+    {
+        GenericObject* block = static_cast<GenericObject*>(Object);
+        block->Next = FreeList_;
+        FreeList_ = block;
+        --ObjectsInUse_;
+        ++Deallocations_;
+    }
+
+    /*!
+      Constructs an object in a block of the pool
+
+      \param args
+        Arguments forwarded to T's constructor.
+
+      \return
+        The object.
+
+      \throw OAException
+        When all blocks are in use. Anything T's constructor throws is
+        rethrown after the block is freed.
+    */
+    template <typename... Args>
+    T* emplace(Args&&... args)
+    {
+        void* block = Allocate();
+        try
+        {
+            return ::new (block) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            Free(block);
+            throw;
+        }
+    }
+
+    /*!
+      Destroys an object and frees its block
+
+      \param object
+        An object from emplace (nullptr is ignored).
+    */
+    void destroy(T* object)
+    {
+        if (!object)
+        {
+            return;
+        }
+        object->~T();
+        Free(object);
+    }
+
+    /*!
+      Checks whether a pointer is the start of one of the pool's blocks
+
+      \param Object
+        The pointer.
+
+      \return
+        True if it is; otherwise, false.
+    */
+    bool Owns(const void* Object) const
+    {
+        const unsigned char* first = Page_ + FIRST_BLOCK_OFFSET;
+        const unsigned char* address = static_cast<const unsigned char*>(Object);
+        if (address < first || address >= first + N * BLOCK_STRIDE)
+        {
+            return false;
+        }
+        return static_cast<size_t>(address - first) % BLOCK_STRIDE == 0;
+    }
+
+    /*!
+      Statistics in the form ObjectAllocator reports them (one page, which
+      MostObjects_ is the high-water mark of)
+    */
+    OAStats GetStats() const
+    {
+        OAStats stats;
+        stats.ObjectSize_ = OBJECT_SIZE;
+        stats.PageSize_ = PAGE_SIZE;
+        stats.FreeObjects_ = N - ObjectsInUse_;
+        stats.ObjectsInUse_ = ObjectsInUse_;
+        stats.PagesInUse_ = 1;
+        stats.MostObjects_ = Fresh_;
+        stats.Allocations_ = Allocations_;
+        stats.Deallocations_ = Deallocations_;
+        return stats;
+    }
+
+      // Prevent copy construction and assignment
+    StaticObjectPool(const StaticObjectPool &pool) = delete;            //!< Do not implement!
+    StaticObjectPool &operator=(const StaticObjectPool &pool) = delete; //!< Do not implement!
+
+private:
+    alignas(ALIGNMENT) unsigned char Page_[PAGE_SIZE]; //!< the page (its link word is unused)
+    GenericObject* FreeList_;                          //!< blocks returned, last freed first
+    unsigned Fresh_;                                   //!< blocks handed out at least once (the rest follow in order)
+    unsigned ObjectsInUse_;                            //!< blocks in use
+    unsigned Allocations_;                             //!< total requests to allocate memory
+    unsigned Deallocations_;                           //!< total requests to free memory
+};
+
+#endif
@@ -0,0 +1,1605 @@
+///*!************************************************************************
+//\file   benchmark.cpp
+//\author Maojie Deng (2200840)
+//\par    SIT email: 2200840@sit.singaporetech.edu.sg
+//\par    DP email: maojie.deng@digipen.edu
+//\par    Course: csd2183
+//\par    Assignment 1
+//\date   31-01-2023
+//
+//\brief
+//  Thirteen benchmarks in one program.
+//
+//  threads: allocate/free throughput of the concurrent allocators at 1..N
+//  threads. Every thread runs the Stress() pattern of the driver: allocate a
+//  run of objects, shuffle them and free them all, a number of rounds over.
+//  A second table pairs the threads up as pipelines: one thread allocates,
+//  the other frees what it is handed.
+//
+//  matrix: ObjectAllocator over a sweep of OAConfigs (objects per page, pad
+//  bytes, header type, alignment, debug) and four patterns (LIFO, FIFO,
+//  random, producer/consumer). Every row reports ns/op, p50/p99 latency of a
+//  single call, how far the process's resident size grew over the row (peak
+//  minus the size before its allocator was made, so memory the heap kept
+//  from earlier rows can hide some of it), pages and the ratio to the same
+//  pattern through UseCPPMemManager_ (new/delete). Output
+//  is a table, CSV or JSON. With --max-ratio the exit code is 1 when a
+//  non-debug configuration is slower than new/delete by more than the ratio,
+//  so a build script can gate on it.
+//
+//  containers: std::map, std::unordered_map and std::list with the default
+//  allocator against PoolAllocator over one PoolResource.
+//
+//  churn: random allocate/free around a working set, then a drain to a tenth
+//  of it and more churn, with the global free list against SlabPages_. Rows
+//  give ns/op and the pages left after FreeEmptyPages.
+//
+//  pads: the per-block cost of ValidatePages and of a checked Free (and the
+//  Allocate after it) with each PatternScan kernel the CPU supports, from the
+//  byte loop the pads were checked with before up to the widest vector.
+//
+//  scan: DumpMemoryInUse and ValidatePages over a large heap against their
+//  parallel versions at 1..N threads.
+//
+//  burst: a burst of allocations from an empty allocator with pages of a
+//  fixed size against pages that double up to MaxObjectsPerPage_, with and
+//  without debug patterns. Rows give ns/op and the pages allocated.
+//
+//  startup: the cost of getting a working set in place. An allocator that
+//  makes its pages on demand, one that Reserve()s them first and one that
+//  also keeps them in an arena; rows give the setup time, the ns/op, p99.9
+//  and worst call of the first requests, and the ns/op once pages are reused.
+//
+//  typed: a move-only type made and destroyed through std::unique_ptr and
+//  new/delete, through ObjectPool handles and through ObjectPool::emplace and
+//  destroy, with the objects freed in the order they were made and shuffled.
+//  Then the bare Allocate/Free of the pool's configuration, and a
+//  StaticObjectPool of 100000 objects (when the objects fit in it).
+//
+//  handles: references to objects kept as 8-byte pointers against 32-bit
+//  handles: the bytes of the references, reading every object through them
+//  in random order, allocate/free, and looking up references whose objects
+//  were freed (which only handles can tell).
+//
+//  epoch: a table of entries read without locks by 1..N reader threads while
+//  a writer keeps replacing entries, with EpochObjectAllocator pins and
+//  Retire against a reader-writer lock and Free, for a fixed time. Rows give
+//  the reads and replacements per second (a writer starved by the readers
+//  shows as few replacements), entries seen freed (torn) and the most blocks
+//  waiting to be reclaimed (Retire holds the writer back once all the retire
+//  batches wait, RETIRE_BATCH * RETIRE_BATCHES blocks). First, the single-thread cost of a pin against a
+//  shared lock, and of Retire against Free.
+//
+//  sizes: blocks of mixed sizes (mostly small, some up to 16 KB) allocated
+//  and freed in random order through SizeClassAllocator against new[] and
+//  delete[], then a check that Free rejects pointers it never handed out.
+//
+//  basic: BasicObjectAllocator with ReleasePolicy and DebugPolicy against
+//  ObjectAllocator with the equivalent OAConfigs, Students allocated and
+//  freed in random order, then a check that both report the same errors for
+//  a bad boundary, a double free and an overwritten pad.
+//
+//  usage: benchmark [threads] [max threads] [objects per thread] [rounds]
+//         benchmark matrix [table|csv|json] [objects] [rounds] [--max-ratio R]
+//         benchmark containers [elements] [rounds]
+//         benchmark churn [objects] [operations]
+//         benchmark pads [pad bytes] [objects]
+//         benchmark scan [max threads] [objects]
+//         benchmark burst [objects] [max objects per page]
+//         benchmark startup [objects]
+//         benchmark typed [objects] [rounds]
+//         benchmark handles [objects] [rounds]
+//         benchmark epoch [max readers] [entries] [milliseconds]
+//         benchmark sizes [objects] [rounds]
+//         benchmark basic [objects] [rounds]
+//**************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+#include "ObjectAllocator.h"
+#include "BasicObjectAllocator.h"
+#include "EpochObjectAllocator.h"
+#include "MagazineAllocator.h"
+#include "LockFreeObjectAllocator.h"
+#include "ShardedObjectAllocator.h"
+#include "SizeClassAllocator.h"
+#include "ObjectPool.h"
+#include "PatternScan.h"
+#include "PoolAllocator.h"
+#include "PRNG.h"
+#include "StaticObjectPool.h"
+
+using std::cout;
+using std::endl;
+using std::printf;
+
+struct Student
+{
+    int Age;
+    float GPA;
+    long Year;
+    long ID;
+};
+
+/*!
+  The single-threaded ObjectAllocator behind one global mutex, the baseline
+*/
+class MutexObjectAllocator
+{
+public:
+    MutexObjectAllocator(size_t ObjectSize, const OAConfig& config) : oa_(ObjectSize, config) {}
+
+    void* Allocate(const char* label = 0)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return oa_.Allocate(label);
+    }
+
+    void Free(void* Object)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        oa_.Free(Object);
+    }
+
+    OAStats GetStats() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return oa_.GetStats();
+    }
+
+private:
+    mutable std::mutex lock_; //!< serializes every call
+    ObjectAllocator oa_;      //!< the allocator being protected
+};
+
+/*!
+  Runs the stress pattern on every thread and returns the elapsed seconds
+*/
+template <typename Allocator>
+double RunThreads(Allocator& allocator, unsigned threads, unsigned objects, unsigned rounds)
+{
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&allocator, objects, rounds, t]()
+        {
+            std::vector<void*> ptrs(objects);
+            std::mt19937 random(t + 1);
+
+            for (unsigned r = 0; r < rounds; ++r)
+            {
+                for (unsigned i = 0; i < objects; ++i)
+                {
+                    ptrs[i] = allocator.Allocate();
+                }
+
+                std::shuffle(ptrs.begin(), ptrs.end(), random);
+                for (unsigned i = 0; i < objects; ++i)
+                {
+                    allocator.Free(ptrs[i]);
+                }
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*!
+  Runs producer/consumer pairs: the producer allocates every object and
+  hands it over through a ring, the consumer frees it. Returns the elapsed
+  seconds.
+*/
+template <typename Allocator>
+double RunPipeline(Allocator& allocator, unsigned threads, unsigned objects, unsigned rounds)
+{
+    const unsigned RING_SIZE = 1024;
+    struct Ring
+    {
+        void* Slots[RING_SIZE];
+        std::atomic<unsigned> Head{ 0 }; //!< next slot the consumer reads
+        std::atomic<unsigned> Tail{ 0 }; //!< next slot the producer writes
+    };
+
+    unsigned pairs = threads / 2 ? threads / 2 : 1;
+    std::vector<Ring> rings(pairs);
+    std::vector<std::thread> workers;
+    unsigned total = objects * rounds;
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned p = 0; p < pairs; ++p)
+    {
+        Ring& ring = rings[p];
+        workers.emplace_back([&allocator, &ring, total]()
+        {
+            for (unsigned i = 0; i < total; ++i)
+            {
+                void* object = allocator.Allocate();
+                unsigned tail = ring.Tail.load(std::memory_order_relaxed);
+                while (tail - ring.Head.load(std::memory_order_acquire) == RING_SIZE)
+                    std::this_thread::yield();
+                ring.Slots[tail % RING_SIZE] = object;
+                ring.Tail.store(tail + 1, std::memory_order_release);
+            }
+        });
+        workers.emplace_back([&allocator, &ring, total]()
+        {
+            for (unsigned i = 0; i < total; ++i)
+            {
+                unsigned head = ring.Head.load(std::memory_order_relaxed);
+                while (ring.Tail.load(std::memory_order_acquire) == head)
+                    std::this_thread::yield();
+                allocator.Free(ring.Slots[head % RING_SIZE]);
+                ring.Head.store(head + 1, std::memory_order_release);
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*!
+  Builds a fresh allocator, runs it and prints one row of the table
+*/
+template <typename Allocator>
+void Measure(const char* name, unsigned threads, unsigned objects, unsigned rounds, double baseline, double& seconds,
+             bool pipeline = false)
+{
+    OAConfig config(false, 4096, 0, false);
+    Allocator allocator(sizeof(Student), config);
+
+    seconds = pipeline ? RunPipeline(allocator, threads, objects, rounds) : RunThreads(allocator, threads, objects, rounds);
+
+    // a pipeline pair shares one allocate/free per object between its two threads
+    if (pipeline)
+        threads = threads / 2 ? threads / 2 * 2 : 2;
+    double operations = (pipeline ? 1.0 : 2.0) * threads * objects * rounds;
+    printf("%-10s %7u %12.1f %10.2f %9.2fx\n", name, threads, operations / seconds / 1e6,
+        seconds * 1e9 / operations, baseline > 0 ? baseline / seconds : 1.0);
+}
+
+/*!
+  The thread scaling tables: mutex, magazine, lock-free and sharded at 1, 2, 4, ... threads
+*/
+int ThreadBenchmark(unsigned maxThreads, unsigned objects, unsigned rounds)
+{
+    if (maxThreads == 0)
+        maxThreads = 1;
+
+    cout << "objects per thread = " << objects << ", rounds = " << rounds << endl;
+    printf("%-10s %7s %12s %10s %10s\n", "allocator", "threads", "Mops/s", "ns/op", "vs mutex");
+
+    // 1, 2, 4, ... and finally the maximum itself
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (unsigned threads : threadCounts)
+    {
+        double baseline = 0, seconds = 0;
+        Measure<MutexObjectAllocator>("mutex", threads, objects, rounds, 0, baseline);
+        Measure<MagazineAllocator>("magazine", threads, objects, rounds, baseline, seconds);
+        Measure<LockFreeObjectAllocator>("lock-free", threads, objects, rounds, baseline, seconds);
+        Measure<ShardedObjectAllocator>("sharded", threads, objects, rounds, baseline, seconds);
+    }
+
+    // producer/consumer pairs, 2, 4, ... threads
+    cout << endl << "pipeline (allocated on one thread, freed on another)" << endl;
+    printf("%-10s %7s %12s %10s %10s\n", "allocator", "threads", "Mops/s", "ns/op", "vs mutex");
+    for (unsigned threads : threadCounts)
+    {
+        if (threads < 2 && maxThreads >= 2)
+            continue;
+        double baseline = 0, seconds = 0;
+        Measure<MutexObjectAllocator>("mutex", threads, objects, rounds, 0, baseline, true);
+        Measure<MagazineAllocator>("magazine", threads, objects, rounds, baseline, seconds, true);
+        Measure<LockFreeObjectAllocator>("lock-free", threads, objects, rounds, baseline, seconds, true);
+        Measure<ShardedObjectAllocator>("sharded", threads, objects, rounds, baseline, seconds, true);
+    }
+
+    return 0;
+}
+
+//****Configuration matrix*****//
+
+/*!
+  Allocation/free orders of the matrix
+*/
+enum Pattern
+{
+    pLIFO,             //!< free in reverse allocation order
+    pFIFO,             //!< free in allocation order
+    pRandom,           //!< free in shuffled order (as Stress() does)
+    pProducerConsumer  //!< one thread allocates, another frees
+};
+
+const char* PATTERN_NAMES[] = { "lifo", "fifo", "random", "producer-consumer" };
+
+/*!
+  One row of the matrix
+*/
+struct MatrixResult
+{
+    std::string Pattern;     //!< name of the pattern
+    unsigned ObjectsPerPage; //!< OAConfig::ObjectsPerPage_
+    unsigned PadBytes;       //!< OAConfig::PadBytes_
+    std::string Header;      //!< name of the header type
+    unsigned Alignment;      //!< OAConfig::Alignment_
+    bool Debug;              //!< OAConfig::DebugOn_
+    bool NewDelete;          //!< the UseCPPMemManager_ baseline
+    double NsPerOp;          //!< mean over the untimed run
+    double P50;              //!< median latency of one call (ns)
+    double P99;              //!< 99th percentile latency of one call (ns)
+    size_t RssGrowthKB;      //!< growth of the process's resident size from before the row to its peak
+    unsigned Pages;          //!< pages in use at the end of the run
+    unsigned MostObjects;    //!< most objects in use at once
+    double VsNew;            //!< ns/op of new/delete for the pattern divided by ns/op of this row
+};
+
+/*!
+  Resident size of the process in KB (0 where it can't be read)
+*/
+size_t ResidentKB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize / 1024;
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident)
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / 1024;
+    return 0;
+#endif
+}
+
+/*!
+  The driver's shuffle, on the same PRNG
+*/
+template <typename T>
+void Shuffle(T* array, unsigned count)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        int r = Digipen::Utils::Random(i, static_cast<int>(count) - 1);
+        std::swap(array[i], array[r]);
+    }
+}
+
+/*!
+  Calls op, adding its duration in ns to samples when there are samples to keep
+*/
+template <typename Op>
+void Timed(Op op, std::vector<float>* samples)
+{
+    if (!samples)
+    {
+        op();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    op();
+    samples->push_back(std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count());
+}
+
+/*!
+  Runs one pattern; returns the elapsed seconds. With samples, every call is timed.
+  peakKB is raised to the process's resident size whenever every object of a
+  round is live. Blocks are labelled by call site, as a client of external
+  headers would.
+*/
+double RunPattern(MutexObjectAllocator& oa, Pattern pattern, unsigned objects, unsigned rounds,
+                  std::vector<float>* samples, size_t& peakKB)
+{
+    std::vector<void*> ptrs(objects);
+    Digipen::Utils::srand(1, 2);
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned r = 0; r < rounds; ++r)
+    {
+        if (pattern == pProducerConsumer)
+        {
+            std::mutex queueLock;
+            std::deque<void*> queue;
+            std::vector<float> consumerSamples;
+            std::vector<float>* consumerOut = samples ? &consumerSamples : nullptr;
+
+            std::thread consumer([&]()
+            {
+                for (unsigned freed = 0; freed < objects;)
+                {
+                    void* block = nullptr;
+                    {
+                        std::lock_guard<std::mutex> guard(queueLock);
+                        if (!queue.empty())
+                        {
+                            block = queue.front();
+                            queue.pop_front();
+                        }
+                    }
+                    if (!block)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    Timed([&]() { oa.Free(block); }, consumerOut);
+                    ++freed;
+                }
+            });
+
+            for (unsigned i = 0; i < objects; ++i)
+            {
+                void* block = nullptr;
+                Timed([&]() { block = oa.Allocate("producer"); }, samples);
+                std::lock_guard<std::mutex> guard(queueLock);
+                queue.push_back(block);
+            }
+            peakKB = std::max(peakKB, ResidentKB());
+            consumer.join();
+
+            if (samples)
+                samples->insert(samples->end(), consumerSamples.begin(), consumerSamples.end());
+            continue;
+        }
+
+        for (unsigned i = 0; i < objects; ++i)
+        {
+            Timed([&]() { ptrs[i] = oa.Allocate("RunPattern"); }, samples);
+        }
+        peakKB = std::max(peakKB, ResidentKB());
+
+        if (pattern == pLIFO)
+            std::reverse(ptrs.begin(), ptrs.end());
+        else if (pattern == pRandom)
+            Shuffle(ptrs.data(), objects);
+
+        for (unsigned i = 0; i < objects; ++i)
+        {
+            Timed([&]() { oa.Free(ptrs[i]); }, samples);
+        }
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*!
+  Measures one configuration on one pattern: an untimed run for ns/op, then a
+  run that times every call for the percentiles, each on a fresh allocator.
+  The resident size is whole-process, so the row reports its growth over the
+  size taken just before the first allocator is made.
+*/
+MatrixResult MeasureConfig(const OAConfig& config, const char* header, Pattern pattern, unsigned objects, unsigned rounds)
+{
+    MatrixResult result;
+    result.Pattern = PATTERN_NAMES[pattern];
+    result.ObjectsPerPage = config.ObjectsPerPage_;
+    result.PadBytes = config.PadBytes_;
+    result.Header = header;
+    result.Alignment = config.Alignment_;
+    result.Debug = config.DebugOn_;
+    result.NewDelete = config.UseCPPMemManager_;
+    result.VsNew = 1.0;
+
+    {
+        size_t baseKB = ResidentKB();
+        size_t peakKB = baseKB;
+        MutexObjectAllocator oa(sizeof(Student), config);
+        double seconds = RunPattern(oa, pattern, objects, rounds, nullptr, peakKB);
+        result.RssGrowthKB = peakKB - baseKB;
+        result.NsPerOp = seconds * 1e9 / (2.0 * objects * rounds);
+        OAStats stats = oa.GetStats();
+        result.Pages = stats.PagesInUse_;
+        result.MostObjects = stats.MostObjects_;
+    }
+
+    {
+        MutexObjectAllocator oa(sizeof(Student), config);
+        std::vector<float> samples;
+        samples.reserve(2 * static_cast<size_t>(objects) * rounds);
+        size_t unused = 0;
+        RunPattern(oa, pattern, objects, rounds, &samples, unused);
+        std::sort(samples.begin(), samples.end());
+        result.P50 = samples.empty() ? 0 : samples[samples.size() / 2];
+        result.P99 = samples.empty() ? 0 : samples[samples.size() * 99 / 100];
+    }
+
+    return result;
+}
+
+/*!
+  Prints the rows in the requested format
+*/
+void PrintMatrix(const std::vector<MatrixResult>& results, const std::string& format, unsigned objects, unsigned rounds)
+{
+    if (format == "csv")
+    {
+        printf("pattern,objects_per_page,pad_bytes,header,alignment,debug,new_delete,ns_per_op,p50_ns,p99_ns,rss_growth_kb,pages,most_objects,vs_new\n");
+        for (const MatrixResult& r : results)
+        {
+            printf("%s,%u,%u,%s,%u,%d,%d,%.2f,%.1f,%.1f,%zu,%u,%u,%.3f\n", r.Pattern.c_str(), r.ObjectsPerPage, r.PadBytes,
+                r.Header.c_str(), r.Alignment, r.Debug ? 1 : 0, r.NewDelete ? 1 : 0, r.NsPerOp, r.P50, r.P99, r.RssGrowthKB, r.Pages,
+                r.MostObjects, r.VsNew);
+        }
+        return;
+    }
+
+    if (format == "json")
+    {
+        printf("{\n  \"objects\": %u,\n  \"rounds\": %u,\n  \"results\": [\n", objects, rounds);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const MatrixResult& r = results[i];
+            printf("    {\"pattern\": \"%s\", \"objects_per_page\": %u, \"pad_bytes\": %u, \"header\": \"%s\", \"alignment\": %u, "
+                "\"debug\": %s, \"new_delete\": %s, \"ns_per_op\": %.2f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"rss_growth_kb\": %zu, "
+                "\"pages\": %u, \"most_objects\": %u, \"vs_new\": %.3f}%s\n", r.Pattern.c_str(), r.ObjectsPerPage, r.PadBytes,
+                r.Header.c_str(), r.Alignment, r.Debug ? "true" : "false", r.NewDelete ? "true" : "false", r.NsPerOp, r.P50,
+                r.P99, r.RssGrowthKB, r.Pages, r.MostObjects, r.VsNew, i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+        return;
+    }
+
+    cout << "objects = " << objects << ", rounds = " << rounds << endl;
+    printf("%-18s %6s %4s %-9s %5s %5s %9s %8s %8s %9s %6s %7s\n", "pattern", "opp", "pad", "header", "align", "debug",
+        "ns/op", "p50", "p99", "+rss KB", "pages", "vs new");
+    for (const MatrixResult& r : results)
+    {
+        printf("%-18s %6u %4u %-9s %5u %5s %9.2f %8.1f %8.1f %9zu %6u %6.2fx\n", r.Pattern.c_str(), r.ObjectsPerPage,
+            r.PadBytes, r.NewDelete ? "new" : r.Header.c_str(), r.Alignment, r.Debug ? "on" : "off", r.NsPerOp, r.P50, r.P99,
+            r.RssGrowthKB, r.Pages, r.VsNew);
+    }
+}
+
+/*!
+  Sweeps the configuration matrix over every pattern
+*/
+int MatrixBenchmark(const std::string& format, unsigned objects, unsigned rounds, double maxRatio)
+{
+    struct HeaderChoice
+    {
+        const char* Name;
+        OAConfig::HeaderBlockInfo Info;
+    };
+    const HeaderChoice headers[] = {
+        { "none", OAConfig::HeaderBlockInfo(OAConfig::hbNone) },
+        { "basic", OAConfig::HeaderBlockInfo(OAConfig::hbBasic) },
+        { "extended", OAConfig::HeaderBlockInfo(OAConfig::hbExtended, 4) },
+        { "external", OAConfig::HeaderBlockInfo(OAConfig::hbExternal) },
+    };
+    const unsigned objectsPerPage[] = { 64, 1024 };
+    const unsigned padBytes[] = { 0, 8 };
+    const unsigned alignments[] = { 0, 16 };
+    const bool debugStates[] = { false, true };
+
+    std::vector<MatrixResult> results;
+    int status = 0;
+
+    for (int p = pLIFO; p <= pProducerConsumer; ++p)
+    {
+        Pattern pattern = static_cast<Pattern>(p);
+
+        // the new/delete baseline every row of the pattern is compared with
+        MatrixResult baseline = MeasureConfig(OAConfig(true, objectsPerPage[0], 0), "none", pattern, objects, rounds);
+        results.push_back(baseline);
+
+        for (unsigned opp : objectsPerPage)
+            for (unsigned pad : padBytes)
+                for (const HeaderChoice& header : headers)
+                    for (unsigned alignment : alignments)
+                        for (bool debug : debugStates)
+                        {
+                            OAConfig config(false, opp, 0, debug, pad, header.Info, alignment);
+                            MatrixResult result = MeasureConfig(config, header.Name, pattern, objects, rounds);
+                            result.VsNew = baseline.NsPerOp / result.NsPerOp;
+                            if (maxRatio > 0 && !debug && result.NsPerOp > baseline.NsPerOp * maxRatio)
+                                status = 1;
+                            results.push_back(result);
+                        }
+    }
+
+    PrintMatrix(results, format, objects, rounds);
+    if (status)
+        std::cerr << "some configurations are more than " << maxRatio << "x slower than new/delete" << endl;
+    return status;
+}
+
+//****Standard containers*****//
+
+/*!
+  Inserts shuffled keys, erases every other one, looks the rest up and
+  clears the map, a number of rounds over; returns the elapsed seconds
+*/
+template <typename Map>
+double RunMap(Map& map, const std::vector<int>& keys, unsigned rounds)
+{
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for (unsigned r = 0; r < rounds; ++r)
+    {
+        for (int key : keys)
+            map[key] = key;
+        for (size_t i = 0; i < keys.size(); i += 2)
+            map.erase(keys[i]);
+        for (int key : keys)
+            sum += static_cast<long long>(map.count(key));
+        map.clear();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return sum >= 0 ? seconds : 0;
+}
+
+/*!
+  Pushes at the back, pops at the front, a number of rounds over; returns the elapsed seconds
+*/
+template <typename List>
+double RunList(List& list, unsigned elements, unsigned rounds)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+    {
+        for (unsigned i = 0; i < elements; ++i)
+            list.push_back(static_cast<int>(i));
+        while (!list.empty())
+            list.pop_front();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*!
+  Prints one row of the container table
+*/
+void PrintContainer(const char* name, double heap, double pool, unsigned operations)
+{
+    printf("%-15s %12.2f %12.2f %9.2fx\n", name, heap * 1e9 / operations, pool * 1e9 / operations, heap / pool);
+}
+
+/*!
+  The default allocator against PoolAllocator on map-, hash- and list-heavy work
+*/
+int ContainerBenchmark(unsigned elements, unsigned rounds)
+{
+    std::vector<int> keys(elements);
+    for (unsigned i = 0; i < elements; ++i)
+        keys[i] = static_cast<int>(i);
+    Digipen::Utils::srand(1, 2);
+    Shuffle(keys.data(), elements);
+
+    typedef std::pair<const int, int> Node;
+    PoolResource resource(OAConfig(false, 1024, 0));
+
+    cout << "elements = " << elements << ", rounds = " << rounds << endl;
+    printf("%-15s %12s %12s %10s\n", "container", "heap ns/op", "pool ns/op", "speedup");
+
+    {
+        std::map<int, int> heap;
+        std::map<int, int, std::less<int>, PoolAllocator<Node>> pool{ PoolAllocator<Node>(resource) };
+        unsigned operations = (elements + elements / 2 + elements) * rounds;
+        PrintContainer("std::map", RunMap(heap, keys, rounds), RunMap(pool, keys, rounds), operations);
+    }
+    {
+        std::unordered_map<int, int> heap;
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, PoolAllocator<Node>> pool(
+            0, std::hash<int>(), std::equal_to<int>(), PoolAllocator<Node>(resource));
+        unsigned operations = (elements + elements / 2 + elements) * rounds;
+        PrintContainer("unordered_map", RunMap(heap, keys, rounds), RunMap(pool, keys, rounds), operations);
+    }
+    {
+        std::list<int> heap;
+        std::list<int, PoolAllocator<int>> pool{ PoolAllocator<int>(resource) };
+        PrintContainer("std::list", RunList(heap, elements, rounds), RunList(pool, elements, rounds), 2 * elements * rounds);
+    }
+
+    return 0;
+}
+
+//****Churn and footprint*****//
+
+/*!
+  Churns one configuration; returns the elapsed seconds and the pages in use
+  before and after FreeEmptyPages
+*/
+double RunChurn(bool slab, unsigned objects, unsigned operations, unsigned& pagesBefore, unsigned& pagesAfter)
+{
+    OAConfig config(false, 64, 0);
+    config.SlabPages_ = slab;
+    ObjectAllocator oa(48, config);
+    std::vector<void*> live;
+    live.reserve(objects * 2);
+    std::mt19937 rng(7);
+
+    auto churn = [&](unsigned target) {
+        for (unsigned i = 0; i < operations; ++i)
+        {
+            if (live.empty() || (live.size() < target && rng() % 2) || rng() % 100 < 48)
+                live.push_back(oa.Allocate());
+            else
+            {
+                size_t victim = rng() % live.size();
+                oa.Free(live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    churn(objects);
+    std::shuffle(live.begin(), live.end(), rng);
+    while (live.size() > objects / 10)
+    {
+        oa.Free(live.back());
+        live.pop_back();
+    }
+    churn(objects / 10);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    pagesBefore = oa.GetStats().PagesInUse_;
+    oa.FreeEmptyPages();
+    pagesAfter = oa.GetStats().PagesInUse_;
+    for (void* object : live)
+        oa.Free(object);
+    return seconds;
+}
+
+/*!
+  The global free list against page-local free lists on the same churn
+*/
+int ChurnBenchmark(unsigned objects, unsigned operations)
+{
+    cout << "objects = " << objects << ", operations = " << operations << " x 2" << endl;
+    printf("%-12s %10s %14s %14s\n", "free list", "ns/op", "pages (peak)", "pages (trim)");
+
+    const char* names[] = { "global", "slab" };
+    for (int slab = 0; slab < 2; ++slab)
+    {
+        unsigned before = 0, after = 0;
+        double seconds = RunChurn(slab != 0, objects, operations, before, after);
+        printf("%-12s %10.2f %14u %14u\n", names[slab], seconds * 1e9 / (2.0 * operations + objects), before, after);
+    }
+    return 0;
+}
+
+//****Pad checking kernels*****//
+
+/*!
+  ValidatePages and checked Free/Allocate pairs with every supported pad
+  checking kernel
+*/
+int PadBenchmark(unsigned padBytes, unsigned objects)
+{
+    const unsigned passes = 20;
+    OAConfig config(false, 1024, 0, true, padBytes);
+    ObjectAllocator oa(64, config);
+    std::vector<void*> ptrs(objects);
+    for (void*& ptr : ptrs)
+        ptr = oa.Allocate();
+
+    cout << "pad bytes = " << padBytes << ", objects = " << objects << ", best kernel = "
+         << PatternScan::Name(PatternScan::Best()) << endl;
+    printf("%-8s %16s %16s\n", "kernel", "validate ns/blk", "free+alloc ns");
+
+    const PatternScan::KERNEL_TYPE kernels[] = { PatternScan::kerBytes, PatternScan::kerWords, PatternScan::kerSSE2,
+                                                 PatternScan::kerAVX2 };
+    for (PatternScan::KERNEL_TYPE kernel : kernels)
+    {
+        if (!PatternScan::Supported(kernel))
+            continue;
+        PatternScan::Use(kernel);
+
+        auto start = std::chrono::steady_clock::now();
+        unsigned corrupted = 0;
+        for (unsigned pass = 0; pass < passes; ++pass)
+            corrupted += oa.ValidatePages([](const void*, size_t) {});
+        double validate = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned pass = 0; pass < passes; ++pass)
+        {
+            for (void* ptr : ptrs)
+                oa.Free(ptr);
+            for (void*& ptr : ptrs)
+                ptr = oa.Allocate();
+        }
+        double churn = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        double blocks = static_cast<double>(oa.GetStats().PagesInUse_) * config.ObjectsPerPage_ * passes;
+        printf("%-8s %16.2f %16.2f%s\n", PatternScan::Name(kernel), validate / blocks,
+            churn / (static_cast<double>(objects) * passes), corrupted ? "  (corruption reported!)" : "");
+    }
+
+    PatternScan::Use(PatternScan::Best());
+    for (void* ptr : ptrs)
+        oa.Free(ptr);
+    return 0;
+}
+
+//****Parallel heap scans*****//
+
+/*!
+  Times one scan of the heap in ms
+*/
+template <typename Scan>
+double TimeScan(Scan scan)
+{
+    auto start = std::chrono::steady_clock::now();
+    scan();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*!
+  The single-threaded whole-heap scans against the parallel ones
+*/
+int ScanBenchmark(unsigned maxThreads, unsigned objects)
+{
+    OAConfig config(false, 1024, 0, true, 16);
+    ObjectAllocator oa(48, config);
+    std::vector<void*> ptrs(objects);
+    for (void*& ptr : ptrs)
+        ptr = oa.Allocate();
+    // a third of the blocks free, so the dump has gaps to skip
+    for (unsigned i = 0; i < objects; i += 3)
+        oa.Free(ptrs[i]);
+
+    auto none = [](const void*, size_t) {};
+    double dump = TimeScan([&]() { oa.DumpMemoryInUse(none); });
+    double validate = TimeScan([&]() { oa.ValidatePages(none); });
+
+    cout << "objects = " << objects << ", pages = " << oa.GetStats().PagesInUse_ << endl;
+    printf("%-8s %10s %10s %10s %10s\n", "threads", "dump ms", "speedup", "valid. ms", "speedup");
+    printf("%-8s %10.2f %10s %10.2f %10s\n", "serial", dump, "1.00x", validate, "1.00x");
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        double parallelDump = TimeScan([&]() { oa.DumpMemoryInUseParallel(none, threads); });
+        double parallelValidate = TimeScan([&]() { oa.ValidatePagesParallel(none, threads); });
+        printf("%-8u %10.2f %9.2fx %10.2f %9.2fx\n", threads, parallelDump, dump / parallelDump, parallelValidate,
+            validate / parallelValidate);
+    }
+
+    for (unsigned i = 1; i < objects; ++i)
+        if (i % 3)
+            oa.Free(ptrs[i]);
+    return 0;
+}
+
+//****Bursts and page growth*****//
+
+/*!
+  Fixed-size pages against growing pages on a burst of allocations
+*/
+int BurstBenchmark(unsigned objects, unsigned maxObjectsPerPage)
+{
+    const unsigned rounds = 5;
+    cout << "objects = " << objects << ", objects per page = 64, growing up to " << maxObjectsPerPage << endl;
+    printf("%-8s %-6s %10s %8s\n", "pages", "debug", "ns/op", "pages");
+
+    std::vector<void*> ptrs(objects);
+    for (int debug = 0; debug < 2; ++debug)
+        for (int grow = 0; grow < 2; ++grow)
+        {
+            OAConfig config(false, 64, 0, debug != 0, debug ? 8 : 0);
+            config.MaxObjectsPerPage_ = grow ? maxObjectsPerPage : 0;
+            double seconds = 0;
+            unsigned pages = 0;
+            for (unsigned r = 0; r < rounds; ++r)
+            {
+                auto start = std::chrono::steady_clock::now();
+                ObjectAllocator oa(48, config);
+                for (void*& ptr : ptrs)
+                    ptr = oa.Allocate();
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                pages = oa.GetStats().PagesInUse_;
+                for (void* ptr : ptrs)
+                    oa.Free(ptr);
+            }
+            printf("%-8s %-6s %10.2f %8u\n", grow ? "growing" : "fixed", debug ? "on" : "off",
+                seconds * 1e9 / (static_cast<double>(objects) * rounds), pages);
+        }
+    return 0;
+}
+
+//****Startup and prewarming*****//
+
+/*!
+  Setup and first-request costs with pages made on demand, reserved, and reserved in an arena
+*/
+int StartupBenchmark(unsigned objects)
+{
+    const unsigned objectsPerPage = 1024;
+    const unsigned pages = (objects + objectsPerPage - 1) / objectsPerPage;
+    cout << "objects = " << objects << ", pages = " << pages << endl;
+    printf("%-10s %10s %12s %10s %10s %12s\n", "pages", "setup ms", "first ns/op", "p99.9 ns", "max us", "reuse ns/op");
+
+    const char* names[] = { "on demand", "reserved", "arena" };
+    std::vector<void*> ptrs(objects);
+    std::vector<float> samples;
+    samples.reserve(objects);
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        OAConfig config(false, objectsPerPage, pages);
+        config.Arena_ = mode == 2;
+
+        auto start = std::chrono::steady_clock::now();
+        ObjectAllocator oa(48, config);
+        if (mode > 0)
+            oa.Reserve(objects);
+        double setup = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // the first requests, each timed
+        samples.clear();
+        start = std::chrono::steady_clock::now();
+        for (void*& ptr : ptrs)
+            Timed([&]() { ptr = oa.Allocate(); }, &samples);
+        double first = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::sort(samples.begin(), samples.end());
+
+        // once the pages exist every mode should cost the same
+        start = std::chrono::steady_clock::now();
+        for (void* ptr : ptrs)
+            oa.Free(ptr);
+        for (void*& ptr : ptrs)
+            ptr = oa.Allocate();
+        double reuse = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%-10s %10.2f %12.2f %10.1f %10.1f %12.2f\n", names[mode], setup, first / objects,
+            samples[samples.size() * 999 / 1000], samples.back() / 1000, reuse / (2.0 * objects));
+        for (void* ptr : ptrs)
+            oa.Free(ptr);
+    }
+    return 0;
+}
+
+//****Typed pool*****//
+
+/*!
+  A move-only object with a member that owns memory of its own
+*/
+struct Message
+{
+    Message(unsigned id, std::unique_ptr<unsigned> payload) : Id(id), Payload(std::move(payload)) {}
+
+    unsigned Id;                       //!< which message
+    std::unique_ptr<unsigned> Payload; //!< moved in, never copied
+    double Stamp[4];                   //!< brings the object to 48 bytes
+};
+
+/*!
+  Makes objects rounds times over; free(i) releases the object made i-th,
+  in order or shuffled
+*/
+template <typename Make, typename Free>
+double RunTyped(unsigned objects, unsigned rounds, bool shuffled, Make make, Free free)
+{
+    std::vector<unsigned> order(objects);
+    for (unsigned i = 0; i < objects; ++i)
+        order[i] = i;
+    if (shuffled)
+        Shuffle(order.data(), objects);
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+    {
+        for (unsigned i = 0; i < objects; ++i)
+            make(i);
+        for (unsigned i : order)
+            free(i);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (2.0 * objects * rounds);
+}
+
+static StaticObjectPool<Message, 100000> FixedMessages; //!< the typed benchmark's static pool
+
+/*!
+  ns/op of unique_ptr with new/delete against ObjectPool handles and emplace/destroy
+*/
+int TypedBenchmark(unsigned objects, unsigned rounds)
+{
+    cout << "objects = " << objects << ", rounds = " << rounds << ", sizeof(Message) = " << sizeof(Message) << endl;
+    printf("%-22s %10s %10s\n", "objects", "in order", "shuffled");
+
+    ObjectPool<Message> pool;
+    ObjectAllocator bare(sizeof(Message), pool.allocator().GetConfig());
+    std::vector<std::unique_ptr<Message>> heap(objects);
+    std::vector<ObjectPool<Message>::Handle> handles(objects);
+    std::vector<Message*> raw(objects);
+    std::vector<void*> blocks(objects);
+    double results[5][2] = {};
+    for (int shuffled = 0; shuffled < 2; ++shuffled)
+    {
+        results[0][shuffled] = RunTyped(objects, rounds, shuffled != 0,
+            [&](unsigned i) { heap[i].reset(new Message(i, std::unique_ptr<unsigned>())); },
+            [&](unsigned i) { heap[i].reset(); });
+        results[1][shuffled] = RunTyped(objects, rounds, shuffled != 0,
+            [&](unsigned i) { handles[i] = pool.make(i, std::unique_ptr<unsigned>()); },
+            [&](unsigned i) { handles[i].reset(); });
+        results[2][shuffled] = RunTyped(objects, rounds, shuffled != 0,
+            [&](unsigned i) { raw[i] = pool.emplace(i, std::unique_ptr<unsigned>()); },
+            [&](unsigned i) { pool.destroy(raw[i]); });
+        results[3][shuffled] = RunTyped(objects, rounds, shuffled != 0,
+            [&](unsigned i) { blocks[i] = bare.Allocate(); },
+            [&](unsigned i) { bare.Free(blocks[i]); });
+        if (objects <= FixedMessages.CAPACITY)
+            results[4][shuffled] = RunTyped(objects, rounds, shuffled != 0,
+                [&](unsigned i) { raw[i] = FixedMessages.emplace(i, std::unique_ptr<unsigned>()); },
+                [&](unsigned i) { FixedMessages.destroy(raw[i]); });
+    }
+
+    const char* names[] = { "unique_ptr new/delete", "ObjectPool::Handle", "emplace/destroy", "Allocate/Free", "StaticObjectPool" };
+    for (int row = 0; row < 5; ++row)
+        if (row < 4 || objects <= FixedMessages.CAPACITY)
+            printf("%-22s %10.2f %10.2f\n", names[row], results[row][0], results[row][1]);
+    return 0;
+}
+
+//****Handles*****//
+
+/*!
+  Pointers against 32-bit handles as references to objects
+*/
+int HandleBenchmark(unsigned objects, unsigned rounds)
+{
+    cout << "objects = " << objects << ", rounds = " << rounds << endl;
+    printf("%-10s %10s %10s %14s %12s\n", "reference", "bytes", "read ns", "alloc/free ns", "stale ns");
+
+    OAConfig config(false, 1024, 0);
+    std::vector<unsigned> order(objects);
+    for (unsigned i = 0; i < objects; ++i)
+        order[i] = i;
+    Shuffle(order.data(), objects);
+
+    for (int handles = 0; handles < 2; ++handles)
+    {
+        ObjectAllocator oa(32, config);
+        std::vector<void*> pointers(handles ? 0 : objects);
+        std::vector<ObjectAllocator::OBJECTHANDLE> ids(handles ? objects : 0);
+
+        // make the objects, each holding its number
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned r = 0; r < rounds; ++r)
+        {
+            for (unsigned i = 0; i < objects; ++i)
+            {
+                void* object;
+                if (handles)
+                {
+                    ids[i] = oa.AllocateHandle();
+                    object = oa.Resolve(ids[i]);
+                }
+                else
+                    object = pointers[i] = oa.Allocate();
+                *static_cast<unsigned*>(object) = i;
+            }
+            if (r + 1 == rounds)
+                break;
+            for (unsigned i : order)
+                if (handles)
+                    oa.FreeHandle(ids[i]);
+                else
+                    oa.Free(pointers[i]);
+        }
+        double churn = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+            (2.0 * objects * rounds - objects);
+
+        // read every object through its reference, in random order
+        unsigned long long sum = 0;
+        start = std::chrono::steady_clock::now();
+        for (unsigned r = 0; r < rounds; ++r)
+            for (unsigned i : order)
+                sum += handles ? *static_cast<unsigned*>(oa.Resolve(ids[i])) : *static_cast<unsigned*>(pointers[i]);
+        double read = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+            (static_cast<double>(objects) * rounds);
+
+        // free them all, then ask whether each reference is still good
+        for (unsigned i : order)
+            if (handles)
+                oa.FreeHandle(ids[i]);
+            else
+                oa.Free(pointers[i]);
+        unsigned stale = 0;
+        start = std::chrono::steady_clock::now();
+        for (unsigned i : order)
+            stale += handles ? oa.Resolve(ids[i]) == nullptr : 0;
+        double check = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / objects;
+
+        size_t bytes = handles ? objects * sizeof(ObjectAllocator::OBJECTHANDLE) : objects * sizeof(void*);
+        if (handles)
+            printf("%-10s %10zu %10.2f %14.2f %12.2f\n", "handle", bytes, read, churn, check);
+        else
+            printf("%-10s %10zu %10.2f %14.2f %12s\n", "pointer", bytes, read, churn, "n/a");
+        if (sum != static_cast<unsigned long long>(objects - 1) * objects / 2 * rounds || (handles && stale != objects))
+            printf("error: sum %llu, stale %u\n", sum, stale);
+    }
+    return 0;
+}
+
+//****Epochs*****//
+
+/*!
+  Entry of the epoch benchmark's table; Check is wrong if the entry was
+  freed (or reused) under a reader
+*/
+struct Entry
+{
+    unsigned long long Key;     //!< slot of the table the entry belongs in
+    unsigned long long Version; //!< replacement that made it
+    unsigned long long Check;   //!< Key ^ Version ^ ENTRY_CHECK
+};
+
+static const unsigned long long ENTRY_CHECK = 0x9E3779B97F4A7C15ULL; //!< mixed into every Entry's Check
+
+/*!
+  Fills an entry, returning it
+*/
+Entry* MakeEntry(void* block, unsigned long long key, unsigned long long version)
+{
+    Entry* entry = static_cast<Entry*>(block);
+    entry->Key = key;
+    entry->Version = version;
+    entry->Check = key ^ version ^ ENTRY_CHECK;
+    return entry;
+}
+
+/*!
+  Reads every entry of the table, returning how many were torn
+*/
+unsigned ReadTable(const std::vector<std::atomic<Entry*>>& table)
+{
+    unsigned torn = 0;
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        const volatile Entry* entry = table[i].load(std::memory_order_acquire);
+        if (entry->Key != i || (entry->Key ^ entry->Version ^ ENTRY_CHECK) != entry->Check)
+            ++torn;
+    }
+    return torn;
+}
+
+/*!
+  Readers scan the table while one writer replaces entries, under pins
+  (epoch) or a shared lock, until the time is up (each side checks the time
+  itself, so a starved writer can't hold the readers up). reads, writes and
+  torn count the entries read, replaced and seen freed, pending the most
+  blocks that waited to be reclaimed.
+*/
+void RunIndex(bool epoch, unsigned readers, unsigned entries, unsigned milliseconds, unsigned long long& reads,
+              unsigned long long& writes, unsigned long long& torn, unsigned& pending)
+{
+    OAConfig config(false, 4096, 0, false);
+    EpochObjectAllocator epochs(sizeof(Entry), config);
+    ObjectAllocator locked(sizeof(Entry), config);
+    std::shared_timed_mutex lock;
+
+    std::vector<std::atomic<Entry*>> table(entries);
+    for (unsigned i = 0; i < entries; ++i)
+        table[i].store(MakeEntry(epoch ? epochs.Allocate() : locked.Allocate(), i, 0), std::memory_order_relaxed);
+
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    std::atomic<unsigned long long> totalReads{ 0 }, totalTorn{ 0 };
+    std::vector<std::thread> workers;
+    for (unsigned r = 0; r < readers; ++r)
+    {
+        workers.emplace_back([&]()
+        {
+            unsigned long long read = 0, bad = 0;
+            while (std::chrono::steady_clock::now() < end)
+            {
+                if (epoch)
+                {
+                    EpochObjectAllocator::ReadGuard guard(epochs);
+                    bad += ReadTable(table);
+                }
+                else
+                {
+                    std::shared_lock<std::shared_timed_mutex> guard(lock);
+                    bad += ReadTable(table);
+                }
+                read += entries;
+            }
+            totalReads += read;
+            totalTorn += bad;
+        });
+    }
+
+    pending = 0;
+    writes = 0;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        unsigned key = Digipen::Utils::Random(0, static_cast<int>(entries) - 1);
+        if (epoch)
+        {
+            Entry* entry = MakeEntry(epochs.Allocate(), key, ++writes);
+            epochs.Retire(table[key].exchange(entry, std::memory_order_acq_rel));
+            pending = std::max(pending, epochs.Pending());
+        }
+        else
+        {
+            std::unique_lock<std::shared_timed_mutex> guard(lock);
+            Entry* entry = MakeEntry(locked.Allocate(), key, ++writes);
+            locked.Free(table[key].exchange(entry, std::memory_order_acq_rel));
+        }
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+    reads = totalReads;
+    torn = totalTorn;
+}
+
+/*!
+  Epoch-based reclamation against a reader-writer lock
+*/
+int EpochBenchmark(unsigned maxReaders, unsigned entries, unsigned milliseconds)
+{
+    if (entries == 0)
+        entries = 1;
+    cout << "entries = " << entries << ", milliseconds = " << milliseconds << endl;
+
+    // single thread: what a reader pays to start and end a read, a writer to give a block back
+    const unsigned calls = 1000000;
+    EpochObjectAllocator epochs(sizeof(Entry), OAConfig(false, 4096, 0));
+    ObjectAllocator plain(sizeof(Entry), OAConfig(false, 4096, 0));
+    std::shared_timed_mutex lock;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < calls; ++i)
+        epochs.Unpin(epochs.Pin());
+    double pin = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < calls; ++i)
+    {
+        lock.lock_shared();
+        lock.unlock_shared();
+    }
+    double shared = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < calls; ++i)
+        epochs.Retire(epochs.Allocate());
+    double retire = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < calls; ++i)
+        plain.Free(plain.Allocate());
+    double free = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    printf("%-24s %8.2f ns\n%-24s %8.2f ns\n", "Pin + Unpin", pin, "shared lock + unlock", shared);
+    printf("%-24s %8.2f ns\n%-24s %8.2f ns\n\n", "Allocate + Retire", retire, "Allocate + Free", free);
+
+    printf("%-8s %8s %12s %12s %8s %10s\n", "reclaim", "readers", "Mreads/s", "Mwrites/s", "torn", "pending");
+    std::vector<unsigned> readerCounts;
+    for (unsigned readers = 1; readers < maxReaders; readers *= 2)
+        readerCounts.push_back(readers);
+    readerCounts.push_back(maxReaders ? maxReaders : 1);
+
+    for (unsigned readers : readerCounts)
+    {
+        for (int epoch = 0; epoch < 2; ++epoch)
+        {
+            unsigned long long reads = 0, writes = 0, torn = 0;
+            unsigned pending = 0;
+            RunIndex(epoch != 0, readers, entries, milliseconds, reads, writes, torn, pending);
+            double seconds = milliseconds / 1000.0;
+            printf("%-8s %8u %12.2f %12.3f %8llu %10u\n", epoch ? "epoch" : "rwlock", readers, reads / seconds / 1e6,
+                writes / seconds / 1e6, torn, pending);
+        }
+    }
+    return 0;
+}
+
+//****Size classes*****//
+
+/*!
+  Allocates a block of each size and frees them all in random order, rounds
+  times over; returns the ns per allocate or free
+*/
+template <typename Allocate, typename Free>
+double RunSizes(const std::vector<size_t>& sizes, unsigned rounds, Allocate allocate, Free free)
+{
+    std::vector<void*> blocks(sizes.size());
+    std::mt19937 random(1);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < sizes.size(); ++i)
+            blocks[i] = allocate(sizes[i]);
+        std::shuffle(blocks.begin(), blocks.end(), random);
+        for (void* block : blocks)
+            free(block);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        (2.0 * sizes.size() * rounds);
+}
+
+/*!
+  SizeClassAllocator against the system heap, and its checks on Free
+*/
+int SizeBenchmark(unsigned objects, unsigned rounds)
+{
+    // 90% up to 256 bytes, 9% up to a page, 1% above MAX_CLASS_SIZE
+    std::mt19937 random(2);
+    std::uniform_int_distribution<int> kinds(0, 99), small(1, 256), medium(257, 4096), big(4097, 16384);
+    std::vector<size_t> sizes(objects);
+    for (size_t& size : sizes)
+    {
+        int kind = kinds(random);
+        size = static_cast<size_t>(kind < 90 ? small(random) : kind < 99 ? medium(random) : big(random));
+    }
+
+    cout << "objects = " << objects << ", rounds = " << rounds << endl;
+    printf("%-16s %10s %10s\n", "allocator", "ns/op", "vs heap");
+
+    double heap = RunSizes(sizes, rounds, [](size_t size) { return static_cast<void*>(new char[size]); },
+        [](void* block) { delete[] static_cast<char*>(block); });
+    SizeClassAllocator classes;
+    double pooled = RunSizes(sizes, rounds, [&classes](size_t size) { return classes.Allocate(size); },
+        [&classes](void* block) { classes.Free(block); });
+    printf("%-16s %10.2f %9.2fx\n", "new[]/delete[]", heap, 1.0);
+    printf("%-16s %10.2f %9.2fx\n", "size classes", pooled, heap / pooled);
+
+    // pointers Free never handed out: not on a pool page and not a large block
+    int local = 0;
+    char* large = static_cast<char*>(classes.Allocate(SizeClassAllocator::MAX_CLASS_SIZE + 1));
+    void* foreign[] = { &local, large + 16 };
+    unsigned rejected = 0;
+    for (void* pointer : foreign)
+    {
+        try
+        {
+            classes.Free(pointer);
+        }
+        catch (const OAException& exception)
+        {
+            if (exception.code() == OAException::E_BAD_BOUNDARY)
+                ++rejected;
+        }
+    }
+    classes.Free(large);
+    printf("foreign pointers rejected: %u of 2, large blocks left: %u\n", rejected, classes.LargeInUse());
+    return rejected == 2 && classes.LargeInUse() == 0 ? 0 : 1;
+}
+
+//****Compile-time policies*****//
+
+/*!
+  Allocates a number of Students and frees them in random order, rounds times
+  over; returns the ns per allocate or free
+*/
+template <typename Allocator>
+double RunBasic(Allocator& allocator, unsigned objects, unsigned rounds)
+{
+    std::vector<void*> blocks(objects);
+    std::mt19937 random(1);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+    {
+        for (unsigned i = 0; i < objects; ++i)
+            blocks[i] = allocator.Allocate();
+        std::shuffle(blocks.begin(), blocks.end(), random);
+        for (void* block : blocks)
+            allocator.Free(block);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        (2.0 * objects * rounds);
+}
+
+/*!
+  Frees a bad pointer, a block twice and a block with a pad overwritten;
+  returns the error codes in that order
+*/
+template <typename Allocator>
+std::vector<int> BasicErrors(Allocator& allocator)
+{
+    std::vector<int> codes;
+    char* block = static_cast<char*>(allocator.Allocate());
+    char* freed = static_cast<char*>(allocator.Allocate());
+    char* padded = static_cast<char*>(allocator.Allocate());
+    allocator.Free(freed);
+    padded[sizeof(Student)] = 0;
+
+    void* bad[] = { block + 1, freed, padded };
+    for (void* pointer : bad)
+    {
+        try
+        {
+            allocator.Free(pointer);
+            codes.push_back(-1);
+        }
+        catch (const OAException& exception)
+        {
+            codes.push_back(exception.code());
+        }
+    }
+    allocator.Free(block);
+    return codes;
+}
+
+/*!
+  BasicObjectAllocator with ReleasePolicy and DebugPolicy against
+  ObjectAllocator with the equivalent OAConfigs, and the errors each
+  reports on Free
+*/
+int BasicBenchmark(unsigned objects, unsigned rounds)
+{
+    const unsigned perPage = 64;
+    cout << "objects = " << objects << ", rounds = " << rounds << ", objects per page = " << perPage << endl;
+    printf("%-10s %12s %12s %10s\n", "policy", "run time", "compiled", "speedup");
+
+    ObjectAllocator release(sizeof(Student), OAConfig(false, perPage, 0));
+    BasicObjectAllocator<sizeof(Student)> basicRelease(perPage, 0);
+    double runtime = RunBasic(release, objects, rounds);
+    double compiled = RunBasic(basicRelease, objects, rounds);
+    printf("%-10s %12.2f %12.2f %9.2fx\n", "release", runtime, compiled, runtime / compiled);
+
+    ObjectAllocator debug(sizeof(Student), OAConfig(false, perPage, 0, true, 8, OAConfig::HeaderBlockInfo(OAConfig::hbBasic)));
+    BasicObjectAllocator<sizeof(Student), DebugPolicy<>> basicDebug(perPage, 0);
+    runtime = RunBasic(debug, objects, rounds);
+    compiled = RunBasic(basicDebug, objects, rounds);
+    printf("%-10s %12.2f %12.2f %9.2fx\n", "debug", runtime, compiled, runtime / compiled);
+
+    // both should report bad boundary, multiple free and corruption, in that order
+    std::vector<int> expected = BasicErrors(debug);
+    std::vector<int> reported = BasicErrors(basicDebug);
+    printf("errors on Free: %d %d %d (run time) %d %d %d (compiled)\n", expected[0], expected[1], expected[2],
+        reported[0], reported[1], reported[2]);
+    return expected == reported && basicDebug.GetStats().ObjectsInUse_ == debug.GetStats().ObjectsInUse_ ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "basic") == 0)
+    {
+        unsigned objects = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 100000;
+        unsigned rounds = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 10;
+        return BasicBenchmark(objects, rounds);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "sizes") == 0)
+    {
+        unsigned objects = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 100000;
+        unsigned rounds = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 10;
+        return SizeBenchmark(objects, rounds);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "epoch") == 0)
+    {
+        unsigned maxReaders = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+        unsigned entries = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 1024;
+        unsigned milliseconds = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 500;
+        return EpochBenchmark(maxReaders, entries, milliseconds);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "handles") == 0)
+    {
+        unsigned objects = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 1000000;
+        unsigned rounds = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 5;
+        return HandleBenchmark(objects, rounds);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "typed") == 0)
+    {
+        unsigned objects = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 100000;
+        unsigned rounds = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 20;
+        return TypedBenchmark(objects, rounds);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "startup") == 0)
+    {
+        unsigned objects = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 1000000;
+        return StartupBenchmark(objects);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "burst") == 0)
+    {
+        unsigned objects = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 1000000;
+        unsigned maxObjectsPerPage = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 65536;
+        return BurstBenchmark(objects, maxObjectsPerPage);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "scan") == 0)
+    {
+        unsigned maxThreads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+        unsigned objects = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 2000000;
+        return ScanBenchmark(maxThreads, objects);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "pads") == 0)
+    {
+        unsigned padBytes = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 32;
+        unsigned objects = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 100000;
+        return PadBenchmark(padBytes, objects);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "churn") == 0)
+    {
+        unsigned objects = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 20000;
+        unsigned operations = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 200000;
+        return ChurnBenchmark(objects, operations);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "containers") == 0)
+    {
+        unsigned elements = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 100000;
+        unsigned rounds = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 5;
+        return ContainerBenchmark(elements, rounds);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "matrix") == 0)
+    {
+        std::string format = "table";
+        unsigned objects = 100000;
+        unsigned rounds = 3;
+        double maxRatio = 0;
+        std::vector<const char*> positional;
+
+        for (int i = 2; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--max-ratio") == 0 && i + 1 < argc)
+                maxRatio = std::atof(argv[++i]);
+            else
+                positional.push_back(argv[i]);
+        }
+        if (positional.size() > 0)
+            format = positional[0];
+        if (positional.size() > 1)
+            objects = static_cast<unsigned>(std::atoi(positional[1]));
+        if (positional.size() > 2)
+            rounds = static_cast<unsigned>(std::atoi(positional[2]));
+
+        return MatrixBenchmark(format, objects, rounds, maxRatio);
+    }
+
+    // "threads" is the default and may be left out
+    int first = (argc > 1 && std::strcmp(argv[1], "threads") == 0) ? 2 : 1;
+    unsigned maxThreads = std::thread::hardware_concurrency();
+    unsigned objects = 100000;
+    unsigned rounds = 10;
+
+    if (argc > first)
+        maxThreads = static_cast<unsigned>(std::atoi(argv[first]));
+    if (argc > first + 1)
+        objects = static_cast<unsigned>(std::atoi(argv[first + 1]));
+    if (argc > first + 2)
+        rounds = static_cast<unsigned>(std::atoi(argv[first + 2]));
+
+    return ThreadBenchmark(maxThreads, objects, rounds);
+}
@@ -2,6 +2,13 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 using std::cout;
 using std::endl;
@@ -13,6 +20,8 @@ int SHOWREAL = 0;
 int SHOW_EXCEPTIONS = 0;
 
 #include "ObjectAllocator.h"
+#include "EpochObjectAllocator.h"
+#include "ObjectPool.h"
 #include "PRNG.h"
 
 struct Student
@@ -57,6 +66,12 @@ void TestFreeEmptyPages2(void);       // debug, padding=2, header, align=16
 void TestFreeEmptyPages3(void);       // debug, padding=6
 void StressFreeChecking(void);        //
 void Stress(bool UseNewDelete);       // 
+void TestEpochThreads(void);          // epoch, readers pinned while a writer retires
+void TestFreeChecks(void);            // debug, padding=4/8, every header
+void TestValidateSlices(void);        // debug, padding=8, header
+void TestHandles(void);               //
+void TestTelemetry(void);             //
+void TestObjectPool(void);            //
 
 struct Person
 {
@@ -2084,6 +2099,460 @@ void Test1(void)
     delete oa;
 }
 
+// Prints whether a check of the tests with a known outcome held
+void Expect(bool passed, const char* what)
+{
+    cout << (passed ? "passed: " : "FAILED: ") << what << endl;
+}
+
+// Returns the code of the exception Free throws for object, or -1 if it takes it
+int FreeError(ObjectAllocator* oa, void* object)
+{
+    try
+    {
+        oa->Free(object);
+    }
+    catch (const OAException& e)
+    {
+        return e.code();
+    }
+    return -1;
+}
+
+std::vector<const void*> CorruptedBlocks;
+
+void CollectCallback(const void* block, size_t actual_size)
+{
+    (void)actual_size;
+    CorruptedBlocks.push_back(block);
+}
+
+// Allocates 10 blocks on 4-block pages and damages the pads of blocks 2, 4 (freed), 7 and 9
+void CorruptPads(ObjectAllocator* oa, void* blocks[10])
+{
+    for (int i = 0; i < 10; i++)
+        blocks[i] = oa->Allocate();
+    oa->Free(blocks[4]);
+
+    static_cast<unsigned char*>(blocks[2])[-1] = 0;
+    static_cast<unsigned char*>(blocks[7])[sizeof(Student)] = 0;
+    static_cast<unsigned char*>(blocks[9])[-8] = 0;
+    static_cast<unsigned char*>(blocks[9])[sizeof(Student) + 7] = 0;
+    static_cast<unsigned char*>(blocks[4])[-3] = 0;
+}
+
+// Sorts the blocks reported since the last call and compares them with blocks 2, 4, 7 and 9
+bool CorruptedAsExpected(void* blocks[10])
+{
+    std::vector<const void*> expected = { blocks[2], blocks[4], blocks[7], blocks[9] };
+    std::sort(expected.begin(), expected.end());
+    std::sort(CorruptedBlocks.begin(), CorruptedBlocks.end());
+    bool same = CorruptedBlocks == expected;
+    CorruptedBlocks.clear();
+    return same;
+}
+
+void TestFreeChecks(void)
+{
+    // The values are the ones the allocator gave before the in-use bitmap (it walked
+    // the free list), save one: a pointer into the middle of a block is E_BAD_BOUNDARY
+    // now, where the old boundary check only looked at the page and Free then failed
+    // with E_CORRUPTED_BLOCK.
+    OAConfig::HeaderBlockInfo headers[] = {
+        OAConfig::HeaderBlockInfo(OAConfig::hbNone),
+        OAConfig::HeaderBlockInfo(OAConfig::hbBasic),
+        OAConfig::HeaderBlockInfo(OAConfig::hbExtended, 2),
+        OAConfig::HeaderBlockInfo(OAConfig::hbExternal) };
+    const char* names[] = { "no header", "basic header", "extended header", "external header" };
+
+    for (int h = 0; h < 4; h++)
+    {
+        try
+        {
+            cout << names[h] << ":" << endl;
+            ObjectAllocator oa(sizeof(Student), OAConfig(false, 4, 3, true, 4, headers[h], 0));
+            void* p[10];
+            for (int i = 0; i < 10; i++)
+                p[i] = oa.Allocate();
+            oa.Free(p[1]);
+            oa.Free(p[5]);
+            oa.Free(p[8]);
+
+            Expect(FreeError(&oa, p[5]) == OAException::E_MULTIPLE_FREE, "freeing a block twice is E_MULTIPLE_FREE");
+            Expect(FreeError(&oa, p[1]) == OAException::E_MULTIPLE_FREE, "freeing an older freed block is E_MULTIPLE_FREE");
+            Expect(FreeError(&oa, static_cast<char*>(p[2]) + 1) == OAException::E_BAD_BOUNDARY, "a pointer into a block is E_BAD_BOUNDARY");
+
+            void* last = oa.Allocate();
+            OAStats stats = oa.GetStats();
+            Expect(last == p[8], "Allocate takes the block freed last");
+            Expect(stats.Allocations_ == 11 && stats.Deallocations_ == 3 && stats.MostObjects_ == 10,
+                   "rejected frees don't count: 11 allocations, 3 deallocations, 10 at most");
+            Expect(stats.ObjectsInUse_ == 8 && stats.FreeObjects_ == 4 && stats.PagesInUse_ == 3,
+                   "8 objects in use and 4 free on 3 pages");
+
+            int rest[] = { 0, 2, 3, 4, 6, 7, 8, 9 };
+            for (int i : rest)
+                oa.Free(p[i]);
+            unsigned freed = oa.FreeEmptyPages();
+            stats = oa.GetStats();
+            Expect(freed == 3 && stats.PagesInUse_ == 0 && stats.FreeObjects_ == 0 && stats.ObjectsInUse_ == 0,
+                   "FreeEmptyPages releases the 3 pages and their free blocks");
+            Expect(stats.Deallocations_ == 11, "11 deallocations");
+            Expect(FreeError(&oa, p[0]) == OAException::E_BAD_BOUNDARY, "a block of a released page is E_BAD_BOUNDARY");
+
+            ObjectAllocator padded(sizeof(Student), OAConfig(false, 4, 3, true, 8, headers[h], 0));
+            CorruptPads(&padded, p);
+            unsigned count = padded.ValidatePages(CollectCallback);
+            Expect(count == 4 && CorruptedAsExpected(p), "ValidatePages reports the 4 blocks with damaged pads");
+            Expect(FreeError(&padded, p[2]) == OAException::E_CORRUPTED_BLOCK, "freeing a block with a damaged left pad is E_CORRUPTED_BLOCK");
+            Expect(FreeError(&padded, p[7]) == OAException::E_CORRUPTED_BLOCK, "freeing a block with a damaged right pad is E_CORRUPTED_BLOCK");
+            Expect(FreeError(&padded, p[0]) == -1, "a sound block is freed");
+        }
+        catch (const OAException& e)
+        {
+            if (SHOW_EXCEPTIONS)
+                cout << e.what() << endl;
+            else
+                cout << "Exception thrown during TestFreeChecks." << endl;
+        }
+    }
+}
+
+void TestValidateSlices(void)
+{
+    try
+    {
+        ObjectAllocator oa(sizeof(Student), OAConfig(false, 4, 3, true, 8, OAConfig::HeaderBlockInfo(OAConfig::hbBasic), 0));
+        void* p[10];
+        CorruptPads(&oa, p);
+
+        unsigned count = oa.ValidatePages(CollectCallback);
+        Expect(count == 4 && CorruptedAsExpected(p), "ValidatePages reports the 4 blocks with damaged pads");
+
+        unsigned budgets[] = { 1, 5, 100 };
+        for (unsigned budget : budgets)
+        {
+            unsigned checked = 0, corrupted = 0, calls = 0;
+            OAValidateSlice slice;
+            do
+            {
+                slice = oa.ValidateSome(CollectCallback, budget);
+                checked += slice.Checked_;
+                corrupted += slice.Corrupted_;
+                calls++;
+            } while (!slice.PassDone_);
+            cout << "budget " << budget << ": " << calls << " calls" << endl;
+            Expect(checked == oa.Capacity() && slice.Checked_ <= budget, "one pass checks every block once, within the budget");
+            Expect(corrupted == 4 && CorruptedAsExpected(p), "one pass reports the blocks ValidatePages does");
+        }
+
+        OAValidateSlice one = oa.ValidateSome(CollectCallback, 0);
+        CorruptedBlocks.clear();
+        Expect(one.Checked_ == 1, "a budget of 0 still checks a block");
+
+        count = oa.ValidatePagesParallel(CollectCallback, 2);
+        Expect(count == 4 && CorruptedAsExpected(p), "ValidatePagesParallel reports the same blocks");
+    }
+    catch (const OAException& e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestValidateSlices." << endl;
+    }
+}
+
+void TestHandles(void)
+{
+    typedef ObjectAllocator::OBJECTHANDLE OBJECTHANDLE;
+    const unsigned bits = ObjectAllocator::HANDLE_GENERATION_BITS;
+    try
+    {
+        ObjectAllocator oa(sizeof(Student), OAConfig(false, 4, 0));
+        OBJECTHANDLE old[4], fresh[4];
+        for (int i = 0; i < 4; i++)
+            old[i] = oa.AllocateHandle();
+
+        void* first = oa.Resolve(old[0]);
+        Expect(first != 0 && oa.HandleOf(first) == old[0], "a handle resolves to its object and back");
+
+        oa.FreeHandle(old[0]);
+        Expect(oa.Resolve(old[0]) == 0, "a freed object's handle resolves to nullptr");
+        bool threw = false;
+        try
+        {
+            oa.FreeHandle(old[0]);
+        }
+        catch (const OAException& e)
+        {
+            threw = e.code() == OAException::E_MULTIPLE_FREE;
+        }
+        Expect(threw, "freeing through a stale handle is E_MULTIPLE_FREE");
+
+        old[0] = oa.AllocateHandle();
+        Expect(oa.Resolve(old[0]) == first, "the block is reused under a new generation");
+
+        oa.Free(oa.Resolve(old[1]));
+        Expect(oa.Resolve(old[1]) == 0, "Free makes the handles of a block stale too");
+        oa.FreeHandle(old[0]);
+        oa.FreeHandle(old[2]);
+        oa.FreeHandle(old[3]);
+        Expect(oa.FreeEmptyPages() == 1, "the page is released");
+
+        for (int i = 0; i < 4; i++)
+            fresh[i] = oa.AllocateHandle();
+        bool stale = true, live = true, reused = true;
+        for (int i = 0; i < 4; i++)
+        {
+            stale = stale && oa.Resolve(old[i]) == 0;
+            live = live && oa.Resolve(fresh[i]) != 0;
+            bool slotTaken = false;
+            for (int j = 0; j < 4; j++)
+                slotTaken = slotTaken || (fresh[j] >> bits) == (old[i] >> bits);
+            reused = reused && slotTaken;
+        }
+        Expect(reused, "the new page takes the released page's index and slots");
+        Expect(stale, "handles to the released page stay stale");
+        Expect(live, "handles to the new page resolve");
+        Expect(oa.Resolve(0) == 0, "handle 0 is never valid");
+    }
+    catch (const OAException& e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestHandles." << endl;
+    }
+}
+
+void TestTelemetry(void)
+{
+    try
+    {
+        // Ten blocks per page, allocated a page at a time, then the pages left
+        // with 0, 1, 5 and 10 blocks in use
+        ObjectAllocator oa(sizeof(Student), OAConfig(false, 10, 0));
+        void* p[40];
+        for (int i = 0; i < 40; i++)
+            p[i] = oa.Allocate();
+        for (int i = 0; i < 10; i++)
+            oa.Free(p[i]);
+        for (int i = 11; i < 20; i++)
+            oa.Free(p[i]);
+        for (int i = 25; i < 30; i++)
+            oa.Free(p[i]);
+
+        OATelemetry telemetry = oa.GetTelemetry();
+        unsigned expected[OATelemetry::OCCUPANCY_BUCKETS] = { 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+        Expect(std::equal(expected, expected + OATelemetry::OCCUPANCY_BUCKETS, telemetry.Occupancy_),
+               "one page in buckets 0, 1, 5 and 10");
+        Expect(telemetry.PagesInUse_ == 4 && telemetry.Capacity_ == 40 && telemetry.ObjectsInUse_ == 16,
+               "4 pages, 40 blocks, 16 in use");
+        Expect(telemetry.FreeBytesInPartialPages_ == 14 * sizeof(Student) && telemetry.TotalBytes_ == 40 * sizeof(Student),
+               "14 free blocks on the partial pages");
+        Expect(telemetry.Fragmentation_ > 0.349 && telemetry.Fragmentation_ < 0.351, "fragmentation 14/40");
+        Expect(telemetry.Allocations_ == 40 && telemetry.Deallocations_ == 24, "40 allocations and 24 deallocations");
+        Expect(telemetry.PagesCreated_ == 4 && telemetry.PagesFreed_ == 0, "4 pages created");
+
+        oa.FreeEmptyPages();
+        oa.Free(p[10]);
+        telemetry = oa.GetTelemetry(&telemetry);
+        Expect(telemetry.Occupancy_[0] == 1 && telemetry.Occupancy_[1] == 0 && telemetry.PagesFreed_ == 1,
+               "the empty page is released and the page with one block in use empties");
+        Expect(telemetry.FreeBytesInPartialPages_ == 5 * sizeof(Student), "5 free blocks on the partial pages");
+        Expect(telemetry.ToText().find("objectallocator_page_occupancy{max_percent=\"50\"} 1\n") != std::string::npos,
+               "the text export has a line per bucket");
+    }
+    catch (const OAException& e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestTelemetry." << endl;
+    }
+}
+
+struct Tracked
+{
+    static int Live;
+    std::unique_ptr<int> Value;
+
+    explicit Tracked(std::unique_ptr<int> value, bool fail = false) : Value(std::move(value))
+    {
+        if (fail)
+            throw OAException(OAException::E_NO_MEMORY, "Tracked: failing construction.");
+        ++Live;
+    }
+    ~Tracked() { --Live; }
+};
+
+int Tracked::Live = 0;
+
+struct alignas(32) Wide
+{
+    char Bytes[40];
+};
+
+void TestObjectPool(void)
+{
+    try
+    {
+        ObjectPool<Tracked> a, b;
+        Tracked* x = a.emplace(std::unique_ptr<int>(new int(7)));
+        Expect(Tracked::Live == 1 && *x->Value == 7, "emplace moves its arguments into the object");
+        Expect(ObjectPool<Tracked>::owner(x) == &a, "owner finds the pool of an object");
+
+        ObjectPool<Tracked>::Handle handle = b.make(std::unique_ptr<int>(new int(8)));
+        Expect(ObjectPool<Tracked>::owner(handle.get()) == &b, "owner tells the pools apart");
+        Expect(sizeof(handle) == sizeof(Tracked*), "a Handle is the size of a pointer");
+        handle.reset();
+        Expect(Tracked::Live == 1 && b.allocator().GetStats().ObjectsInUse_ == 0, "the Handle destroys its object in its own pool");
+        Expect(a.allocator().GetStats().ObjectsInUse_ == 1, "the other pool keeps its object");
+
+        a.destroy(x);
+        a.destroy(0);
+        Expect(Tracked::Live == 0 && a.allocator().GetStats().ObjectsInUse_ == 0, "destroy runs the destructor and frees the block");
+
+        bool threw = false;
+        try
+        {
+            a.emplace(std::unique_ptr<int>(new int(9)), true);
+        }
+        catch (const OAException&)
+        {
+            threw = true;
+        }
+        Expect(threw && a.allocator().GetStats().ObjectsInUse_ == 0, "a throwing constructor gives the block back");
+        Expect(a.FreeEmptyPages() == 1, "the empty page is released");
+
+        ObjectPool<Wide> wide;
+        bool aligned = true;
+        for (int i = 0; i < 3; i++)
+            aligned = aligned && reinterpret_cast<uintptr_t>(wide.emplace()) % alignof(Wide) == 0;
+        Expect(aligned, "objects are aligned on alignof(T)");
+
+        ObjectPool<Student> debug(OAConfig(false, 0, 0, true, 4, OAConfig::HeaderBlockInfo(OAConfig::hbBasic)));
+        Student* s = debug.emplace();
+        debug.destroy(s);
+        int code = -1;
+        try
+        {
+            debug.destroy(s);
+        }
+        catch (const OAException& e)
+        {
+            code = e.code();
+        }
+        Expect(code == OAException::E_MULTIPLE_FREE, "destroying an object twice is E_MULTIPLE_FREE when debugging");
+    }
+    catch (const OAException& e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestObjectPool." << endl;
+    }
+}
+
+void TestEpochThreads(void)
+{
+    const unsigned capacity = EpochObjectAllocator::RETIRE_BATCH * EpochObjectAllocator::RETIRE_BATCHES;
+    try
+    {
+        OAConfig config(false, 128, 0);
+        EpochObjectAllocator oa(sizeof(Student), config);
+
+        // A pinned reader holds every batch: TryRetire fails once they are all waiting
+        std::atomic<bool> pinned(false), release(false);
+        std::thread reader([&]()
+        {
+            EpochObjectAllocator::ReadGuard guard(oa);
+            pinned = true;
+            while (!release)
+                std::this_thread::yield();
+        });
+        while (!pinned)
+            std::this_thread::yield();
+
+        unsigned retired = 0;
+        void* block = oa.Allocate();
+        while (oa.TryRetire(block))
+        {
+            ++retired;
+            block = oa.Allocate();
+        }
+        Expect(retired == capacity, "TryRetire takes blocks until every batch waits on the reader");
+        Expect(oa.Pending() == capacity, "every retired block is pending");
+
+        // Retire waits for the reader rather than failing
+        std::atomic<bool> done(false);
+        std::thread writer([&]()
+        {
+            oa.Retire(block);
+            done = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        Expect(!done, "Retire waits while the reader is pinned");
+        release = true;
+        reader.join();
+        writer.join();
+        Expect(done && oa.Pending() < capacity, "Retire goes on once the reader unpins");
+
+        // Readers look at records while a writer replaces and retires them
+        const unsigned slots = 64;
+        const unsigned replaces = 100000;
+        std::atomic<Student*> table[slots];
+        for (unsigned i = 0; i < slots; i++)
+        {
+            Student* s = static_cast<Student*>(oa.Allocate());
+            s->Age = s->ID = i;
+            table[i] = s;
+        }
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned> torn(0);
+        std::vector<std::thread> readers;
+        for (unsigned r = 0; r < 3; r++)
+        {
+            readers.emplace_back([&, r]()
+            {
+                for (unsigned i = r; !stop; i++)
+                {
+                    EpochObjectAllocator::ReadGuard guard(oa);
+                    const Student* s = table[i % slots].load(std::memory_order_acquire);
+                    int age = s->Age;
+                    std::this_thread::yield();
+                    if (s->ID != age)
+                        ++torn;
+                }
+            });
+        }
+
+        for (unsigned i = 0; i < replaces; i++)
+        {
+            Student* s = static_cast<Student*>(oa.Allocate());
+            s->Age = s->ID = i;
+            oa.Retire(table[i % slots].exchange(s, std::memory_order_acq_rel));
+        }
+        stop = true;
+        for (std::thread& t : readers)
+            t.join();
+        Expect(torn == 0, "no reader sees a record reclaimed under it");
+
+        for (unsigned i = 0; i < slots; i++)
+            oa.Retire(table[i].load());
+        oa.Reclaim();
+        Expect(oa.Pending() == 0 && oa.GetStats().ObjectsInUse_ == 0, "Reclaim frees every retired block once no reader is pinned");
+    }
+    catch (const OAException& e)
+    {
+        if (SHOW_EXCEPTIONS)
+            cout << e.what() << endl;
+        else
+            cout << "Exception thrown during TestEpochThreads." << endl;
+    }
+}
+
 
 int main(int argc, char** argv)
 {
@@ -2215,6 +2684,36 @@ int main(int argc, char** argv)
         cout << endl;
         break;
 #endif
+    case 22:
+        cout << "============================== Test epoch threads..." << endl;
+        TestEpochThreads();
+        cout << endl;
+        break;
+    case 23:
+        cout << "============================== Test free checking (assertions)..." << endl;
+        TestFreeChecks();
+        cout << endl;
+        break;
+    case 24:
+        cout << "============================== Test validate slices..." << endl;
+        TestValidateSlices();
+        cout << endl;
+        break;
+    case 25:
+        cout << "============================== Test handles..." << endl;
+        TestHandles();
+        cout << endl;
+        break;
+    case 26:
+        cout << "============================== Test telemetry..." << endl;
+        TestTelemetry();
+        cout << endl;
+        break;
+    case 27:
+        cout << "============================== Test object pool..." << endl;
+        TestObjectPool();
+        cout << endl;
+        break;
     default:
         cout << "============================== Students..." << endl;
         DoStudents(0, false);
@@ -2279,6 +2778,24 @@ int main(int argc, char** argv)
         cout << "============================== Test free empty pages 3..." << endl;
         TestFreeEmptyPages3();
         cout << endl;
+        cout << "============================== Test epoch threads..." << endl;
+        TestEpochThreads();
+        cout << endl;
+        cout << "============================== Test free checking (assertions)..." << endl;
+        TestFreeChecks();
+        cout << endl;
+        cout << "============================== Test validate slices..." << endl;
+        TestValidateSlices();
+        cout << endl;
+        cout << "============================== Test handles..." << endl;
+        TestHandles();
+        cout << endl;
+        cout << "============================== Test telemetry..." << endl;
+        TestTelemetry();
+        cout << endl;
+        cout << "============================== Test object pool..." << endl;
+        TestObjectPool();
+        cout << endl;
         break;
     }
 